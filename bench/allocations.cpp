@@ -0,0 +1,103 @@
+#include <libini/libini.h>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// Every allocation made through operator new, the library's included.
+static long allocations = 0;
+
+void* operator new(std::size_t size) {
+  allocations++;
+  if (void* pointer = std::malloc(size))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  allocations++;
+  auto align = static_cast<std::size_t>(alignment);
+  if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+
+  // 1000 sections of 100 keys, a third each of integers, floats and strings.
+  void write_file(const std::filesystem::path& path) {
+    std::ofstream file{path};
+    for (int s = 0; s < 1000; s++) {
+      file << "[section" << s << "]\n";
+      for (int k = 0; k < 100; k++) {
+	file << "key" << k << " = ";
+	if (k % 3 == 0)
+	  file << s * 100 + k << '\n';
+	else if (k % 3 == 1)
+	  file << s << '.' << k << '\n';
+	else
+	  file << "'value " << s << ' ' << k << "'\n";
+      }
+    }
+  }
+
+  template<typename F>
+  long count(F function) {
+    long before = allocations;
+    function();
+    return allocations - before;
+  }
+};
+
+/*
+ * Counts the heap allocations of parsing a file of 100k keys: the tree is allocated from the
+ * result's arena, and results are moved rather than copied. Pass a path to count another file.
+ */
+int main(int argc, char** argv) {
+  std::filesystem::path path = argc > 1 ? argv[1] : std::filesystem::temp_directory_path() / "libini_allocations.ini";
+  if (argc <= 1)
+    write_file(path);
+
+  libini::IniParser<libini::MmapLexer> parser(path.string());
+  parser.parse();
+
+  std::cout << "One parse: " << count([&] { parser.parse(); }) << " allocations\n";
+
+  std::vector<libini::IniParserResult> results;
+  results.reserve(8);
+  std::cout << "4 parses moved into a vector: " << count([&] {
+    for (int i = 0; i < 4; i++)
+      results.push_back(parser.parse());
+  }) << " allocations\n";
+
+  std::cout << "4 parses copied into a vector: " << count([&] {
+    for (int i = 0; i < 4; i++) {
+      const auto result = parser.parse();
+      results.push_back(result);
+    }
+  }) << " allocations\n";
+
+  if (argc <= 1)
+    std::filesystem::remove(path);
+
+  return 0;
+}
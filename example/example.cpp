@@ -9,18 +9,18 @@ int main(void) {
   std::cout << "Has member 'my_string'? " << result.has_member("my_string") << '\n';
 
   if (result.has_member("my_string")) {
-    auto my_string = result["my_string"]; // Get the container for the 'my_string' member.
-    auto value = my_string.get_value<libini::IniString>(); // Get the value for 'my_string'.
+    const auto& my_string = result["my_string"]; // Get the container for the 'my_string' member.
+    const auto& value = my_string.get_value<libini::IniString>(); // Get the value for 'my_string'.
 
     std::cout << "my_string = " << value << '\n';
 
     auto future = parser.parse_async(); // Parse the file asynchronously and get a future.
     auto async_result = future.get();   // Wait for the result
 
-    auto my_string_async = async_result["my_string"];
-    auto value_async = my_string_async.get_value<libini::IniString>();
+    const auto& my_string_async = async_result["my_string"];
+    const auto& value_async = my_string_async.get_value<libini::IniString>();
 
-    std::cout << "(async) my_string = " << value << '\n';
+    std::cout << "(async) my_string = " << value_async << '\n';
   }
 
   return 0;
@@ -0,0 +1,77 @@
+#ifndef ARENA_HPP_
+#define ARENA_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory_resource>
+#include <mutex>
+
+namespace libini {
+
+  /*
+   * Monotonic memory resource backing a parse tree. Memory is only released when the arena is destroyed.
+   * Threads parsing parts of the same file each allocate from a region of their own, so they can share
+   * the tree's allocator without taking a lock on every allocation.
+   */
+  class IniArena : public std::pmr::memory_resource {
+  public:
+    IniArena() noexcept = default;
+
+    // An arena hands out pointers into itself, it can be neither copied nor moved.
+    IniArena(const IniArena& other) = delete;
+    IniArena& operator =(const IniArena&) = delete;
+
+    // Bytes the arena and its regions have taken from the heap so far.
+    std::size_t size() const noexcept;
+
+    /*
+     * While a region is alive, allocations from the arena on the thread that created it
+     * go to memory of its own. The memory stays with the arena after the region is gone.
+     */
+    class Region {
+    public:
+      explicit Region(IniArena& arena);
+      ~Region() noexcept;
+
+      Region(const Region& other) = delete;
+      Region& operator =(const Region&) = delete;
+
+    private:
+      IniArena& arena_;
+      std::pmr::monotonic_buffer_resource& resource_;
+      Region* previous_;
+
+      friend class IniArena;
+    };
+
+  private:
+    // Hands out heap memory to the arena's resources, counting it.
+    class Upstream : public std::pmr::memory_resource {
+    public:
+      std::atomic<std::size_t> size{0};
+
+    private:
+      void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+      void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) noexcept override;
+      bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    Upstream upstream_;
+    std::pmr::monotonic_buffer_resource main_{&upstream_};
+    std::deque<std::pmr::monotonic_buffer_resource> regions_;
+    std::mutex mutex_;
+
+    // Innermost region of the calling thread, for any arena.
+    static thread_local Region* current_;
+
+    // The resource to allocate from on the calling thread.
+    std::pmr::monotonic_buffer_resource& resource() noexcept;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) noexcept override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+  };
+};
+
+#endif
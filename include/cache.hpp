@@ -0,0 +1,44 @@
+#ifndef CACHE_HPP_
+#define CACHE_HPP_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+#include "image.hpp"
+#include "parser.hpp"
+
+namespace libini {
+
+  /*
+   * A directory of compiled images of parsed text, keyed by a hash of the text and its size.
+   * Unchanged text is found again no matter which file, path or stream it came from.
+   * Entries are written to a temporary file and renamed into place, so several processes
+   * can share a directory and a reader never sees half an entry. Entries are never removed,
+   * so the directory keeps growing as long as new text is stored.
+   */
+  class IniParseCache {
+  public:
+    // Creates the directory if it does not exist. Throws if it can not be created.
+    explicit IniParseCache(std::filesystem::path directory);
+
+    // The image for the text, or nothing if it is not cached or its entry is not a valid image.
+    std::optional<IniImage> load(std::string_view text) const noexcept;
+
+    // Stores the result of parsing the text. The cache is best effort, returns false if the entry could not be written.
+    bool store(std::string_view text, const IniParserResult& result) const noexcept;
+
+    const std::filesystem::path& directory() const noexcept;
+
+  private:
+    std::filesystem::path directory_;
+
+    /*
+     * Path of the entry for the text.
+     */
+    std::filesystem::path entry_path(std::string_view text) const;
+  };
+};
+
+#endif
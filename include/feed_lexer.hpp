@@ -0,0 +1,69 @@
+#ifndef FEED_LEXER_HPP_
+#define FEED_LEXER_HPP_
+
+#include <coroutine>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "lexer.hpp"
+#include "tokens.hpp"
+
+namespace libini {
+
+  /*
+   * Incremental lexer for input that arrives in pieces, e.g. from a pipe, a socket or a decompressor.
+   * Lexing runs in a coroutine that suspends whenever a token might go on in the next piece,
+   * and lexes that token again from its start once more input has been fed.
+   */
+  class FeedLexer {
+  public:
+    FeedLexer();
+
+    ~FeedLexer() noexcept;
+
+    // A lexer should not be Copyable as it owns a coroutine,
+    // which is not Copyable.
+    FeedLexer(const FeedLexer& other) = delete;
+    FeedLexer& operator =(const FeedLexer&) = delete;
+
+    // But it should be movable.
+    FeedLexer(FeedLexer&& other) noexcept;
+
+    FeedLexer& operator=(FeedLexer&& other) noexcept;
+
+    // Appends a piece of input. It is copied, so it does not have to outlive the call.
+    void feed(std::string_view chunk);
+
+    // Marks the end of the input, so a token running up to it is complete.
+    void finish() noexcept;
+
+    // The next complete token, or nothing if more input is needed or all of it has been lexed.
+    std::optional<IniVariant> next();
+
+    // Whether every token has been handed out. Only after finish().
+    bool done() const noexcept;
+
+  private:
+    struct Lexing;
+
+    // Shared by the lexer and its coroutine: the input not lexed yet and the last token lexed.
+    struct Input {
+      std::string buffer;
+      std::optional<IniVariant> token;
+      bool hungry = false;
+      bool finished = false;
+    };
+
+    std::unique_ptr<Input> input_;
+    std::coroutine_handle<> coroutine_;
+
+    /*
+     * The coroutine. Suspends after every token, and whenever it needs more input.
+     */
+    static Lexing lex(Input& input);
+  };
+};
+
+#endif
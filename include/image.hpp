@@ -0,0 +1,157 @@
+#ifndef IMAGE_HPP_
+#define IMAGE_HPP_
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "parser.hpp"
+#include "tokens.hpp"
+
+namespace libini {
+
+  /*
+   * Compiles a parse result into a binary image that IniImage can answer lookups from without parsing.
+   * The image holds a string table, a section table, an entry per member and two perfect hash tables
+   * over the entries, for bare and for qualified names. Names with the same hash are chained, so a lookup
+   * compares names with one entry unless another name hashes alike. All references inside it are offsets from its start,
+   * so it can be mapped at any address. It is only readable on machines with the same byte order.
+   */
+  std::vector<std::byte> compile_image(const IniParserResult& result);
+
+  // Compiles the result and writes the image to a file. Throws if the file cannot be written.
+  void write_image(const IniParserResult& result, const std::filesystem::path& path);
+
+  class IniImage;
+
+  // A member of an image. Valid as long as the image it came from.
+  class IniImageMember {
+  public:
+    std::string_view get_name() const noexcept;
+
+    // Name of the section the member is in.
+    std::string_view get_section() const noexcept;
+
+    TokenType get_type() const noexcept;
+
+    // The value as a token, strings borrowing from the image.
+    IniVariantView get_variant() const noexcept;
+
+    // Numbers by value, strings as views into the image. Throws std::bad_variant_access for the wrong type.
+    template<typename T>
+    requires ParsableToken<T>
+    auto get_value() const {
+      if (get_type() != T::token_type)
+	throw std::bad_variant_access();
+
+      if constexpr (std::same_as<T, IniInteger>)
+	return integer();
+      else if constexpr (std::same_as<T, IniFloat>)
+	return floating();
+      else
+	return text();
+    }
+
+  private:
+    const IniImage* image_;
+    std::uint32_t entry_;
+
+    IniImageMember(const IniImage& image, std::uint32_t entry) noexcept;
+
+    std::int64_t integer() const noexcept;
+    double floating() const noexcept;
+    std::string_view text() const noexcept;
+
+    friend class IniImage;
+  };
+
+  /*
+   * Read-only view of a compiled image, mapped from a file or borrowed from memory.
+   * Lookups work like those of IniParserResult, straight out of the image.
+   */
+  class IniImage {
+  public:
+    // Maps the file. Throws if it cannot be read or is not a valid image.
+    IniImage(const std::filesystem::path& path);
+
+    // Borrows the bytes, which must outlive the image and be 8-byte aligned. Throws if they are not a valid image.
+    IniImage(std::span<const std::byte> bytes);
+
+    ~IniImage() noexcept;
+
+    // An image may own a mapping, it can not be copied.
+    IniImage(const IniImage& other) = delete;
+    IniImage& operator =(const IniImage&) = delete;
+
+    // But it should be movable.
+    IniImage(IniImage&& other) noexcept;
+
+    IniImage& operator=(IniImage&& other) noexcept;
+
+    bool has_member(std::string_view name) const noexcept;
+
+    IniImageMember operator [](std::string_view name) const;
+
+    /*
+     * Looks up a member without throwing. The name is either a bare key, which resolves to
+     * the first section that has it, or a qualified 'section.key'.
+     */
+    std::optional<IniImageMember> find(std::string_view name) const noexcept;
+
+    // Looks up a member of a specific section without throwing.
+    std::optional<IniImageMember> find(std::string_view section, std::string_view key) const noexcept;
+
+    template<typename T>
+    requires ParsableToken<T>
+    auto get_value(std::string_view name) const {
+      return (*this)[name].template get_value<T>();
+    }
+
+    // Number of sections.
+    std::size_t size() const noexcept;
+
+    // Reports every section and member to the handler, in the order of the original file.
+    template<typename Handler>
+    requires IniEventHandler<Handler>
+    void replay(Handler& handler) const {
+      for (std::uint32_t section = 0; section < size(); section++) {
+	handler.on_section(section_name(section));
+
+	auto [first, count] = section_members(section);
+	for (auto entry = first; entry < first + count; entry++) {
+	  IniImageMember member{*this, entry};
+	  handler.on_key_value(member.get_name(), member.get_variant());
+	}
+      }
+    }
+
+  private:
+    std::span<const std::byte> bytes_;
+    void* mapping_;
+    std::size_t mapping_size_;
+
+    /*
+     * Checks that every table and every reference in the image stays within it.
+     */
+    void validate() const;
+    /*
+     * Releases the current mapping, if any.
+     */
+    void unmap() noexcept;
+
+    std::string_view section_name(std::uint32_t section) const noexcept;
+    // The first entry of the section and the number of entries in it.
+    std::pair<std::uint32_t, std::uint32_t> section_members(std::uint32_t section) const noexcept;
+
+    friend class IniImageMember;
+  };
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef INDEX_HPP_
+#define INDEX_HPP_
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace libini {
+
+  static constexpr std::uint64_t fnv_offset_basis = 14695981039346656037ull;
+  static constexpr std::uint64_t fnv_prime = 1099511628211ull;
+
+  // FNV-1a hash of a name. Pass a previous result as seed to hash names piecewise.
+  static constexpr std::uint64_t hash_name(std::string_view name, std::uint64_t seed = fnv_offset_basis) noexcept {
+    for (char c : name) {
+      seed ^= static_cast<unsigned char>(c);
+      seed *= fnv_prime;
+    }
+    return seed;
+  }
+
+  // Spreads every bit of a name hash over all the others, FNV-1a alone leaves the last characters out of the high bits.
+  static constexpr std::uint64_t mix_hash(std::uint64_t hash) noexcept {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccd;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53;
+    return hash ^ (hash >> 33);
+  }
+
+  /*
+   * Hash and displace, as used for perfect hashes: names are spread over buckets, and each bucket
+   * has a seed that sends its names to different slots. Both counts are powers of two.
+   */
+  static constexpr std::size_t displace_bucket(std::uint64_t hash, std::size_t bucket_count) noexcept {
+    return static_cast<std::size_t>(mix_hash(hash) >> 32) & (bucket_count - 1);
+  }
+
+  static constexpr std::size_t displace_slot(std::uint64_t hash, std::uint64_t seed, std::size_t slot_count) noexcept {
+    return static_cast<std::size_t>(mix_hash(hash ^ seed * 0x9e3779b97f4a7c15)) & (slot_count - 1);
+  }
+
+  // 64-bit hash of a block of text, computed like xxHash64. Reads eight bytes at a time,
+  // so it is much faster than hash_name on whole files.
+  std::uint64_t hash_content(std::string_view text, std::uint64_t seed = 0) noexcept;
+
+  /*
+   * Open-addressing (linear probing) hash index. It maps name hashes to positions in a
+   * container owned by someone else, who also decides what a match is, so lookups
+   * can be done with any key type and without allocating.
+   */
+  class IniFlatIndex {
+  public:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    IniFlatIndex(const allocator_type& allocator = {}) noexcept
+      : slots_(allocator) {}
+
+    IniFlatIndex(const IniFlatIndex& other, const allocator_type& allocator = {})
+      : slots_(other.slots_, allocator), size_(other.size_) {}
+
+    IniFlatIndex(IniFlatIndex&& other) noexcept
+      : slots_(std::move(other.slots_)), size_(std::exchange(other.size_, 0)) {}
+
+    IniFlatIndex(IniFlatIndex&& other, const allocator_type& allocator)
+      : slots_(std::move(other.slots_), allocator), size_(std::exchange(other.size_, 0)) {}
+
+    IniFlatIndex& operator=(IniFlatIndex&& other) {
+      if (this != &other) {
+	slots_ = std::move(other.slots_);
+	size_ = std::exchange(other.size_, 0);
+      }
+      return *this;
+    }
+
+    IniFlatIndex& operator=(const IniFlatIndex& other) {
+      if (this != &other) {
+	slots_ = other.slots_;
+	size_ = other.size_;
+      }
+      return *this;
+    }
+
+    // Returns the position of the entry with the given hash accepted by matches, or npos.
+    template<typename Matcher>
+    std::uint32_t find(std::uint64_t hash, Matcher matches) const {
+      if (slots_.empty())
+	return npos;
+
+      for (std::size_t i = hash & mask(); slots_[i].position != npos; i = (i + 1) & mask())
+	if (slots_[i].hash == hash && matches(slots_[i].position))
+	  return slots_[i].position;
+
+      return npos;
+    }
+
+    // Adds an entry. Callers keep keys unique, typically by calling find() first.
+    void insert(std::uint64_t hash, std::uint32_t position) {
+      // Keep the load factor at or below one half so probe sequences stay short.
+      if ((size_ + 1) * 2 > slots_.size())
+	grow();
+
+      place(hash, position);
+      size_++;
+    }
+
+    // Makes room for the given number of entries, so adding them does not rehash.
+    void reserve(std::size_t count) {
+      if (count * 2 > slots_.size())
+	rehash(std::bit_ceil(count * 2));
+    }
+
+    // Empties the index, keeping its slots for the entries to come.
+    void clear() noexcept {
+      std::fill(slots_.begin(), slots_.end(), Slot{});
+      size_ = 0;
+    }
+
+    std::size_t size() const noexcept {
+      return size_;
+    }
+
+  private:
+    struct Slot {
+      std::uint64_t hash = 0;
+      std::uint32_t position = npos;
+    };
+
+    std::pmr::vector<Slot> slots_;
+    std::size_t size_ = 0;
+
+    std::size_t mask() const noexcept {
+      return slots_.size() - 1;
+    }
+
+    void place(std::uint64_t hash, std::uint32_t position) noexcept {
+      std::size_t i = hash & mask();
+      while (slots_[i].position != npos)
+	i = (i + 1) & mask();
+      slots_[i] = {hash, position};
+    }
+
+    void grow() {
+      rehash(slots_.empty() ? 8 : slots_.size() * 2);
+    }
+
+    // Moves the entries to a power of two number of slots.
+    void rehash(std::size_t slots) {
+      std::pmr::vector<Slot> old(slots, slots_.get_allocator());
+      old.swap(slots_);
+
+      for (const auto& slot : old)
+	if (slot.position != npos)
+	  place(slot.hash, slot.position);
+    }
+  };
+};
+
+#endif
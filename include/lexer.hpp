@@ -5,21 +5,49 @@
 #include <concepts>
 #include <deque>
 #include <exception>
-#include <functional>
+#include <cstddef>
 #include <fstream>
-#include <iterator>
+#include <istream>
 #include <memory_resource>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <variant>
+#include <vector>
 
+#include "scanner.hpp"
 #include "tokens.hpp"
 
 namespace libini {
 
-  using IniTokens = std::pmr::deque<IniVariant>;
-  using IniIterator = std::istream_iterator<char>;
-  using Predicate = std::function<bool(char)>;
-  using ComposerOp = std::function<bool(bool, bool)>;
+  template<typename StringType>
+  using BasicIniTokens = std::pmr::deque<BasicIniVariant<StringType>>;
+  using IniTokens = BasicIniTokens<std::pmr::string>;
+  using IniTokenViews = BasicIniTokens<std::string_view>;
+  using IniIterator = const char*;
+
+  // Compact tokens, along with the text they point into.
+  struct IniCompactTokens {
+    std::string_view text;
+    std::pmr::vector<IniCompactToken> tokens;
+  };
+
+  // What a token was read from: its type and its text in the buffer. The text of
+  // punctuation is the character itself, the text of a comment leaves out the #.
+  struct IniLexeme {
+    TokenType type;
+    std::string_view text;
+  };
+
+  /*
+   * Turns a lexeme into a token, or nothing for the end of the buffer.
+   * Instantiated for both owned (std::pmr::string) and borrowed (std::string_view) tokens.
+   */
+  template<typename StringType>
+  std::optional<BasicIniVariant<StringType>> make_token(const IniLexeme& lexeme) noexcept;
 
   template<typename T>
   concept IniTokenizer = requires(T a, std::pmr::polymorphic_allocator<IniVariant> allocator) {
@@ -27,44 +55,148 @@ namespace libini {
     { a(allocator) } -> std::same_as<IniTokens>;
   };
 
-  static const Predicate compose(Predicate p, Predicate q, ComposerOp op = std::logical_or<bool>()) {
-    // Composes two predicate functions into one.
-    return [p, q, op](char c) { return op(p(c), q(c)); };
-  }
-
+  // A tokenizer that can also hand out tokens borrowing from its input buffer.
   template<typename T>
-  requires std::same_as<T, char>
-  static constexpr Predicate make_predicate(T d) {
-    return [d](T c) { return c == d; };
-  }
+  concept IniViewTokenizer = IniTokenizer<T> && requires(T a, std::pmr::polymorphic_allocator<IniVariantView> allocator) {
+    { a.tokenize_view(allocator) } -> std::same_as<IniTokenViews>;
+  };
 
-  template<typename T, typename... Args>
-  static constexpr Predicate make_predicate(T d, Args... ds) {
-    if constexpr(sizeof...(ds) > 0) {
-      return [d, ds...](T c) {
-	return make_predicate(d)(c) || make_predicate(ds...)(c);
-      };
-    } else
-      return make_predicate(d);
+  // Builds a compile-time character set out of the given characters.
+  template<typename... Args>
+  requires (std::same_as<Args, char> && ...)
+  static constexpr IniCharSet make_predicate(Args... ds) noexcept {
+    return IniCharSet(ds...);
   }
 
-  static const auto is_whitespace = make_predicate(' ', '\t');
+  static constexpr IniCharSet is_whitespace = make_predicate(' ', '\t');
+
+  static constexpr IniCharSet is_comment = make_predicate('#');
+
+  static constexpr IniCharSet is_eol = make_predicate('\n', '\r');
+
+  // Checks if c is between 0 and 9.
+  static constexpr IniCharClass is_numeric = IniCharClass::from([](char c) { return '0' <= c && c <= '9'; });
+
+  // Checks if c is a hexadecimal digit.
+  static constexpr IniCharClass is_hex_digit = IniCharClass::from([](char c) {
+    return ('0' <= c && c <= '9') || ('a' <= c && c <= 'f') || ('A' <= c && c <= 'F');
+  });
+
+  static constexpr IniCharSet is_whitespace_or_eol = make_predicate(' ', '\t', '\n', '\r');
+
+  // Per-state delimiters.
+  static constexpr IniCharSet is_nothing{};
+
+  static constexpr IniCharSet is_rbrace = make_predicate(']');
 
-  static const auto is_comment = make_predicate('#');
+  static constexpr IniCharSet is_double_quote = make_predicate('"');
 
-  static const auto is_eol = make_predicate('\n', '\r');
+  static constexpr IniCharSet is_single_quote = make_predicate('\'');
 
-  static constexpr bool is_numeric(char c) {
-    // Checks if c is between 0 and 9.
-    return '0' <= c && c <= '9';
+  /*
+   * The lexer state machine over a contiguous buffer of characters, pulled one token at a time.
+   * Tokens borrowing from the buffer are only valid while the buffer is alive.
+   */
+  class IniTokenStream {
+  public:
+    IniTokenStream(IniIterator first, IniIterator last) noexcept;
+
+    /*
+     * Lexes and returns the next token, or nothing at the end of the buffer.
+     * Instantiated for both owned (std::pmr::string) and borrowed (std::string_view) tokens.
+     */
+    template<typename StringType>
+    std::optional<BasicIniVariant<StringType>> next() noexcept;
+
+    // Lexes the next token without turning its text into a value. The type is EndOfFile at the end of the buffer.
+    IniLexeme next_lexeme() noexcept;
+
+    // Whether comments are handed out as tokens instead of being skipped. Off by default.
+    void keep_comments(bool keep) noexcept;
+
+    // The part of the buffer that has not been lexed yet.
+    std::string_view remaining() const noexcept;
+
+    // Points the state machine at another buffer, keeping its state, e.g. after the buffer was refilled.
+    void rebase(IniIterator first, IniIterator last) noexcept;
+
+  private:
+    IniIterator fiter_;
+    IniIterator eos_;
+    TokenType previous_;
+    const IniCharSet* delimiter_;
+    bool keep_comments_;
+
+    /*
+     * Peeks in the buffer and determines what the next target is.
+     */
+    TokenType next_token() noexcept;
+    /*
+     * Skips a single-line comment, returning its text without the leading #.
+     */
+    std::string_view skip_comment() noexcept;
+    /*
+     * Reads a 'name' given a set of delimiters to determine where to stop.
+     * This is used for sections, identifiers, strings, numbers etc.
+     * The result borrows from the buffer.
+     */
+    std::string_view read_name(const IniCharSet& delimiter) noexcept;
+
+    /*
+     * Reads a number with an optional sign: a decimal or 0x-prefixed hexadecimal integer,
+     * or a decimal with a fraction and/or an exponent.
+     */
+    IniLexeme read_number() noexcept;
+  };
+
+  // A tokenizer that can also pack its tokens into an array of compact tokens.
+  template<typename T>
+  concept IniCompactTokenizer = IniTokenizer<T> && requires(T a, std::pmr::polymorphic_allocator<IniCompactToken> allocator) {
+    { a.tokenize_compact(allocator) } -> std::same_as<std::optional<IniCompactTokens>>;
   };
 
-  static const auto is_whitespace_or_eol = compose(is_eol, is_whitespace);
+  // A tokenizer that can hand out its state machine so tokens can be pulled one at a time.
+  template<typename T>
+  concept IniStreamingTokenizer = IniTokenizer<T> && requires(T a) {
+    { a.stream() } -> std::same_as<IniTokenStream>;
+  };
+
+  /*
+   * Shared base of the lexers. Every concrete lexer only has to decide
+   * where the buffer of characters comes from.
+   */
+  class IniLexerBase {
+  protected:
+    /*
+     * Read and tokenize an entire in-memory buffer.
+     * Instantiated for both owned (IniTokens) and borrowed (IniTokenViews) tokens.
+     */
+    template<typename StringType>
+    void read_buffer(IniIterator fiter, IniIterator eos, BasicIniTokens<StringType>& tokens) noexcept;
 
-  class IniLexer {
+    /*
+     * Read an entire in-memory buffer into compact tokens.
+     * Fails if the buffer or one of its tokens is too large to be described by one.
+     */
+    bool read_compact(IniIterator fiter, IniIterator eos, IniCompactTokens& tokens) noexcept;
+  };
+
+  class IniLexer : IniLexerBase {
   public:
     IniLexer(const std::string file_name) noexcept;
 
+    // Avoids string literals being mistaken for text.
+    IniLexer(const char* file_name) noexcept;
+
+    // Borrows the text, which must outlive the lexer. Nothing is copied.
+    IniLexer(std::string_view text) noexcept;
+
+    // Borrows the bytes, which must outlive the lexer. Nothing is copied.
+    IniLexer(std::span<const std::byte> bytes) noexcept;
+
+    // Reads the stream to its end, once.
+    IniLexer(std::istream& input);
+
     ~IniLexer() noexcept;
 
     // A lexer should not be Copyable as it relies on ifstream,
@@ -83,36 +215,35 @@ namespace libini {
     // Tokenizes (reads and converts content to token representations) the .ini file pointed to by the fstream. 
     IniTokens tokenize(std::pmr::polymorphic_allocator<IniVariant> allocator); 
 
+    // Same as tokenize(), but the tokens borrow from the lexer's buffer. They stay valid
+    // until the next call to tokenize()/tokenize_view() or until the lexer is destroyed or moved.
+    IniTokenViews tokenize_view(std::pmr::polymorphic_allocator<IniVariantView> allocator);
+
+    // Same as tokenize_view(), but the tokens are packed into 8 bytes each.
+    // Nothing if the text is 4 GiB or more, or if a single token is 16 MiB or more.
+    std::optional<IniCompactTokens> tokenize_compact(std::pmr::polymorphic_allocator<IniCompactToken> allocator);
+
+    // Reads the file and hands out the state machine over it, to pull tokens one at a time.
+    // The stream is valid under the same conditions as the tokens of tokenize_view().
+    // This and the tokenize functions throw if the file can not be opened or read.
+    IniTokenStream stream();
+
   private:
     std::ifstream stream_;
     const std::string file_name_; 
+    std::string buffer_;
+    std::optional<std::string_view> borrowed_;
 
     /*
-     * Read and tokenize an entire .ini file.
+     * Read an entire .ini file into the buffer with a single bulk read.
+     * Throws if the file can not be opened or read.
      */
-    void read_all(IniTokens& tokens) noexcept;
-    /*
-     * Peeks in the file stream and determines what the next target is.
-     */
-    TokenType next_token(IniIterator& fiter,
-			 IniIterator& eos,
-			 const TokenType previous,
-			 Predicate& delimiter) noexcept;
-    /*
-     * Skips a single-line comment.
-     */
-    void skip_comment(IniIterator& fiter, IniIterator& eos) noexcept;
+    void read_all();
+
     /*
-     * Reads a 'name' given a predicate to determine whether or not to stop.
-     * This is used for sections, identifiers, strings, numbers etc.
+     * The text to lex. Reads the file first, if the lexer has one.
      */
-    std::string read_name(IniIterator& fiter,
-			  IniIterator& eos,
-			  Predicate delimiter,
-			  Predicate is_ignorable = [](char) { return false; }) noexcept;
-
-    std::string read_number(IniIterator& fiter,
-		    	    IniIterator& eos) noexcept;
+    std::string_view load();
   };
 };
 
@@ -1,8 +1,18 @@
 #ifndef LIBINI_H_
 #define LIBINI_H_
 
+#include "arena.hpp"
+#include "cache.hpp"
+#include "feed_lexer.hpp"
+#include "image.hpp"
+#include "index.hpp"
 #include "lexer.hpp"
+#include "live_config.hpp"
+#include "mmap_lexer.hpp"
 #include "parser.hpp"
+#include "scanner.hpp"
+#include "schema.hpp"
+#include "thread_pool.hpp"
 #include "tokens.hpp"
 
 #endif
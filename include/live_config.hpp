@@ -0,0 +1,76 @@
+#ifndef LIVE_CONFIG_HPP_
+#define LIVE_CONFIG_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "parser.hpp"
+
+namespace libini {
+
+  /*
+   * A configuration file that reloads itself. A background thread watches the file with inotify,
+   * parses it again whenever it is written or replaced, and publishes the new result as a snapshot.
+   * Readers only load the current snapshot and never wait for a reload. A reload that fails to
+   * parse keeps the previous snapshot.
+   *
+   * Writing the file in place can be seen half done. Writers that need every snapshot to be
+   * complete should write another file and rename it over this one.
+   */
+  class LiveConfig {
+  public:
+    using Snapshot = std::shared_ptr<const IniParserResult>;
+
+    /*
+     * Parses the file and starts watching it. Throws if the file can not be parsed or watched.
+     * After a change, the file is reloaded once it has been left alone for the settle time.
+     */
+    explicit LiveConfig(std::filesystem::path path, std::chrono::milliseconds settle = std::chrono::milliseconds{50});
+
+    // Stops watching the file. Snapshots that are still held stay valid.
+    ~LiveConfig() noexcept;
+
+    // The watcher refers to the object, it can be neither copied nor moved.
+    LiveConfig(const LiveConfig&) = delete;
+    LiveConfig& operator =(const LiveConfig&) = delete;
+
+    // The current result. It does not change while it is held, even if the file is reloaded.
+    Snapshot snapshot() const noexcept;
+
+    // Number of results published so far, the first parse included.
+    std::uint64_t generation() const noexcept;
+
+    // Parses the file now, as if it had changed. Returns false and keeps the current snapshot if parsing fails.
+    bool reload() noexcept;
+
+    // Why the last reload failed, or an empty string if it succeeded.
+    std::string last_error() const;
+
+    const std::filesystem::path& path() const noexcept;
+
+  private:
+    std::filesystem::path path_;
+    std::chrono::milliseconds settle_;
+    std::atomic<Snapshot> snapshot_;
+    std::atomic<std::uint64_t> generation_;
+    // Serializes reloads, readers never take it.
+    mutable std::mutex reload_mutex_;
+    std::string error_;
+    int inotify_;
+    int wakeup_;
+    std::thread watcher_;
+
+    /*
+     * Waits for changes to the file and reloads it, until woken up by the destructor.
+     */
+    void watch() noexcept;
+  };
+};
+
+#endif
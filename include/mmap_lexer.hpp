@@ -0,0 +1,83 @@
+#ifndef MMAP_LEXER_HPP_
+#define MMAP_LEXER_HPP_
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "lexer.hpp"
+#include "tokens.hpp"
+
+namespace libini {
+
+  /*
+   * Zero-copy lexer. Tokenizes straight out of a memory-mapped file
+   * or out of a caller-owned buffer, without going through a stream.
+   */
+  class MmapLexer : IniLexerBase {
+  public:
+    // Maps the file on every call to tokenize(), which throws if it can not be opened or mapped.
+    MmapLexer(const std::string file_name) noexcept;
+
+    // Avoids string literals being mistaken for a buffer.
+    MmapLexer(const char* file_name) noexcept;
+
+    // Borrows the buffer, which must outlive the lexer.
+    MmapLexer(std::span<const char> buffer) noexcept;
+
+    MmapLexer(std::string_view buffer) noexcept;
+
+    MmapLexer(std::span<const std::byte> buffer) noexcept;
+
+    ~MmapLexer() noexcept;
+
+    // A lexer should not be Copyable as it may own a mapping,
+    // which is not Copyable.
+    MmapLexer(const MmapLexer& other) = delete;
+    MmapLexer& operator =(const MmapLexer&) = delete;
+
+    // But it should be movable.
+    MmapLexer(MmapLexer&& other) noexcept;
+
+    MmapLexer& operator=(MmapLexer&& other) noexcept;
+
+    // Dispatch to tokenize().
+    IniTokens operator ()(std::pmr::polymorphic_allocator<IniVariant> allocator);
+
+    // Tokenizes (reads and converts content to token representations) the mapped file or borrowed buffer.
+    IniTokens tokenize(std::pmr::polymorphic_allocator<IniVariant> allocator);
+
+    // Same as tokenize(), but the tokens borrow from the mapping or buffer. They stay valid
+    // until the next call to tokenize()/tokenize_view() or until the lexer is destroyed.
+    IniTokenViews tokenize_view(std::pmr::polymorphic_allocator<IniVariantView> allocator);
+
+    // Same as tokenize_view(), but the tokens are packed into 8 bytes each.
+    // Nothing if the text is 4 GiB or more, or if a single token is 16 MiB or more.
+    std::optional<IniCompactTokens> tokenize_compact(std::pmr::polymorphic_allocator<IniCompactToken> allocator);
+
+    // Maps the file and hands out the state machine over it, to pull tokens one at a time.
+    // The stream is valid under the same conditions as the tokens of tokenize_view().
+    IniTokenStream stream();
+
+  private:
+    std::string file_name_;
+    std::span<const char> buffer_;
+    void* mapping_;
+    std::size_t mapping_size_;
+
+    /*
+     * Maps the file into memory and points the buffer at it.
+     * An empty file results in an empty buffer. Throws if the file can not be opened or mapped.
+     */
+    void map();
+    /*
+     * Releases the current mapping, if any.
+     */
+    void unmap() noexcept;
+  };
+};
+
+#endif
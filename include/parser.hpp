@@ -1,63 +1,143 @@
 #ifndef PARSER_HPP_
 #define PARSER_HPP_
 
+#include <algorithm>
+#include <atomic>
 #include <concepts>
+#include <cstddef>
 #include <exception>
+#include <filesystem>
 #include <future>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#include "arena.hpp"
+#include "index.hpp"
 #include "lexer.hpp"
+#include "thread_pool.hpp"
 #include "tokens.hpp"
 
 namespace libini {
 
+  // Allocator carried by every part of the parse tree.
+  using IniAllocator = std::pmr::polymorphic_allocator<>;
+
   class IniContainer {
     public:
+    using allocator_type = IniAllocator;
+
     IniContainer(IniVariant value) noexcept
       : value_(value) {}
 
+    // Copies a borrowed or owned token, allocating its strings with the given allocator.
+    template<typename StringType>
+    IniContainer(const BasicIniVariant<StringType>& value, const allocator_type& allocator)
+      : value_(copy_value(value, allocator)) {}
+
     IniContainer(const IniContainer& other) noexcept
       : value_(other.value_) {}
 
+    IniContainer(const IniContainer& other, const allocator_type& allocator)
+      : value_(copy_value(other.value_, allocator)) {}
+
+    IniContainer(IniContainer&& other) noexcept = default;
+
     IniContainer& operator=(const IniContainer& other) noexcept {
       if (this != &other)
 	value_ = other.value_;
       return *this;
     }
 
+    IniContainer& operator=(IniContainer&& other) noexcept = default;
+
     template<typename T>
     requires ParsableToken<T>
-    T::value_type get_value() const {
+    const T::value_type& get_value() const {
       return std::get<T>(value_).token_value;
     }
 
+    // A string value as a view of the tree's copy. Throws std::bad_variant_access if the value is not a string.
+    std::string_view get_string() const {
+      return get_value<IniString>();
+    }
+
+    // The token itself, for when its type is not known up front.
+    const IniVariant& get_variant() const noexcept {
+      return value_;
+    }
+
     private:
     IniVariant value_;
+
+    template<typename StringType>
+    static IniVariant copy_value(const BasicIniVariant<StringType>& value, const allocator_type& allocator) {
+      return std::visit([&allocator](const auto& token) -> IniVariant {
+	using T = std::decay_t<decltype(token)>;
+	if constexpr (std::same_as<T, BasicIniString<StringType>>)
+	  return IniString(std::in_place, token.token_value, allocator);
+	else if constexpr (std::same_as<T, BasicIniIdentifier<StringType>>)
+	  return IniIdentifier(std::in_place, token.token_value, allocator);
+	else if constexpr (std::same_as<T, BasicIniSection<StringType>>)
+	  return IniSection(std::in_place, token.token_value, allocator);
+	else if constexpr (std::same_as<T, BasicIniComment<StringType>>)
+	  return IniComment(std::in_place, token.token_value, allocator);
+	else
+	  return token;
+      }, value);
+    }
   };
 
   class IniParserTree {
     public:
-    const std::string get_name() const noexcept;
+    std::string_view get_name() const noexcept;
   };
 
   class IniParserTreeLeaf : IniParserTree {
     public:
-    IniParserTreeLeaf(const std::string name,
-		      const IniContainer container) noexcept
-      : name_(name), container_(container) {}
+    using allocator_type = IniAllocator;
+
+    IniParserTreeLeaf(std::string_view name,
+		      const IniContainer& container,
+		      const allocator_type& allocator = {})
+      : name_(name, allocator), container_(container, allocator) {}
+
+    template<typename StringType>
+    IniParserTreeLeaf(std::string_view name,
+		      const BasicIniVariant<StringType>& value,
+		      const allocator_type& allocator = {})
+      : name_(name, allocator), container_(value, allocator) {}
 
     IniParserTreeLeaf(const IniParserTreeLeaf& other) noexcept
       : name_(other.name_), container_(other.container_) {}
 
+    IniParserTreeLeaf(const IniParserTreeLeaf& other, const allocator_type& allocator)
+      : name_(other.name_, allocator), container_(other.container_, allocator) {}
+
+    IniParserTreeLeaf(IniParserTreeLeaf&& other) noexcept = default;
+
+    // Steals the strings if they already use the allocator, copies them otherwise.
+    IniParserTreeLeaf(IniParserTreeLeaf&& other, const allocator_type& allocator)
+      : name_(std::move(other.name_), allocator),
+	container_(name_.get_allocator() == other.name_.get_allocator()
+		   ? IniContainer(std::move(other.container_))
+		   : IniContainer(other.container_, allocator)) {}
+
     IniParserTreeLeaf& operator=(const IniParserTreeLeaf& other) noexcept {
       if (this != &other) {
 	name_ = other.name_;
@@ -67,119 +147,487 @@ namespace libini {
       return *this;
     }
 
+    IniParserTreeLeaf& operator=(IniParserTreeLeaf&& other) = default;
+
     template<typename T>
     requires ParsableToken<T>
-    T::value_type get_value() const {
+    const T::value_type& get_value() const {
       return container_.get_value<T>();
     }
 
-    const std::string get_name() const noexcept {
+    std::string_view get_string() const {
+      return container_.get_string();
+    }
+
+    const IniVariant& get_variant() const noexcept {
+      return container_.get_variant();
+    }
+
+    // A view of the name, not a copy: index lookups compare names on every probe.
+    std::string_view get_name() const noexcept {
       return name_;
     }
 
     private:
-    std::string name_;
+    std::pmr::string name_;
     IniContainer container_;
   };
 
   class IniParserTreeNode : IniParserTree {
     public:
-    IniParserTreeNode(IniSection section) noexcept
-      : name_(section.token_value) {}
+    using allocator_type = IniAllocator;
+
+    IniParserTreeNode(std::string_view name, const allocator_type& allocator = {})
+      : name_(name, allocator), children_(allocator), index_(allocator) {}
+
+    IniParserTreeNode(IniSection section, const allocator_type& allocator = {})
+      : IniParserTreeNode(std::string_view(section.token_value), allocator) {}
 
     IniParserTreeNode(const IniParserTreeNode& other) noexcept
-      : name_{other.name_}, children_{other.children_} {}
+      : name_{other.name_}, children_{other.children_}, index_{other.index_} {}
+
+    IniParserTreeNode(const IniParserTreeNode& other, const allocator_type& allocator)
+      : name_{other.name_, allocator}, children_{other.children_, allocator}, index_{other.index_, allocator} {}
+
+    IniParserTreeNode(IniParserTreeNode&& other) noexcept = default;
+
+    IniParserTreeNode(IniParserTreeNode&& other, const allocator_type& allocator)
+      : name_{std::move(other.name_), allocator}, children_{std::move(other.children_), allocator},
+	index_{std::move(other.index_), allocator} {}
 
     IniParserTreeNode& operator=(const IniParserTreeNode& other) noexcept {
       if (this != &other) {
 	name_ = other.name_;
 	children_ = other.children_;
+	index_ = other.index_;
       }
 
       return *this;
     }
 
-    IniParserTreeLeaf operator [](const std::string name) const {
-      for (auto child : children_) {
-	if (child.get_name() == name)
-	  return child;
-      }
+    IniParserTreeNode& operator=(IniParserTreeNode&& other) = default;
+
+    const IniParserTreeLeaf& operator [](std::string_view name) const {
+      if (auto child = find(name))
+	return *child;
 
       throw std::runtime_error("libini error: member not found.");
     } 
 
-    bool has_member(const std::string name) const noexcept {
-      for (auto child : children_)
-	if (child.get_name() == name)
-	  return true;
+    // Looks up a member without copying or throwing. Returns nullptr if there is none.
+    const IniParserTreeLeaf* find(std::string_view name) const noexcept {
+      auto position = index_.find(hash_name(name), [this, name](std::uint32_t i) {
+	return children_[i].get_name() == name;
+      });
+
+      return position == IniFlatIndex::npos ? nullptr : &children_[position];
+    }
 
-      return false;
+    bool has_member(std::string_view name) const noexcept {
+      return find(name) != nullptr;
     }
 
-    const std::string get_name() const noexcept {
+    std::string_view get_name() const noexcept {
       return name_;
     }
 
+    std::pmr::vector<IniParserTreeLeaf>::const_iterator begin() const noexcept {
+      return children_.begin();
+    }
+
+    std::pmr::vector<IniParserTreeLeaf>::const_iterator end() const noexcept {
+      return children_.end();
+    }
+
+    std::size_t size() const noexcept {
+      return children_.size();
+    }
+
     template<typename T>
     requires ParsableToken<T>
-    T::value_type get_value(const std::string name) const {
-      auto child = (*this)[name];
-      return child.get_value<T>();
+    const T::value_type& get_value(std::string_view name) const {
+      if (auto child = find(name))
+	return child->get_value<T>();
+
+      throw std::runtime_error("libini error: member not found.");
+    }
+
+    std::string_view get_string(std::string_view name) const {
+      return (*this)[name].get_string();
     }
 
-    void insert(IniParserTreeLeaf child) noexcept {
+    // Copies the leaf in, using the node's allocator.
+    void insert(const IniParserTreeLeaf& child) noexcept {
+      index(child.get_name());
       children_.push_back(child);
     }
 
+    // Moves the leaf in, only copying if it uses a different allocator.
+    void insert(IniParserTreeLeaf&& child) noexcept {
+      index(child.get_name());
+      children_.push_back(std::move(child));
+    }
+
+    // Constructs the leaf in place, using the node's allocator.
+    template<typename StringType>
+    void insert(std::string_view name, const BasicIniVariant<StringType>& value) noexcept {
+      index(name);
+      children_.emplace_back(name, value);
+    }
+
     private:
-    std::string name_;
-    std::vector<IniParserTreeLeaf> children_;
+    std::pmr::string name_;
+    std::pmr::vector<IniParserTreeLeaf> children_;
+    IniFlatIndex index_;
+
+    // Indexes the member about to be appended.
+    // The first member with a given name wins, just like a front-to-back scan.
+    void index(std::string_view name) {
+      auto hash = hash_name(name);
+      bool duplicate = index_.find(hash, [this, name](std::uint32_t i) {
+	return children_[i].get_name() == name;
+      }) != IniFlatIndex::npos;
+
+      if (!duplicate)
+	index_.insert(hash, static_cast<std::uint32_t>(children_.size()));
+    }
   };
 
   using IniParserRoots = std::pmr::vector<IniParserTreeNode>;
-  
+
+  template<typename LexerType>
+  requires IniTokenizer<LexerType>
+  class IniParser;
+
+  /*
+   * The result of parsing a file. It owns a single arena that every node, leaf, name and value
+   * is allocated from, so parsing costs a handful of large allocations and destroying the
+   * result just releases the arena.
+   */
   class IniParserResult {
     public:
-    IniParserResult(IniParserRoots roots) noexcept
-      : roots_(roots) {}
+    IniParserResult(const IniParserRoots& roots) noexcept
+      : IniParserResult() {
+      tree_->roots = roots;
+      build_index();
+    }
     IniParserResult(const IniParserResult& other) noexcept
-      : roots_{other.roots_} {}
+      : arena_{std::make_unique<IniArena>()},
+	tree_{other.tree_ ? make_tree(*other.tree_) : make_tree()} {}
+    // Moving hands over the arena, nothing is copied. A moved-from result is empty.
+    IniParserResult(IniParserResult&& other) noexcept
+      : arena_{std::move(other.arena_)}, tree_{std::exchange(other.tree_, nullptr)} {}
     IniParserResult& operator =(const IniParserResult& other) noexcept {
-      if (this != &other)
-	roots_ = other.roots_;
+      if (this != &other) {
+	IniParserResult copy{other};
+	std::swap(arena_, copy.arena_);
+	std::swap(tree_, copy.tree_);
+      }
+      return *this;
+    }
+    IniParserResult& operator =(IniParserResult&& other) noexcept {
+      std::swap(arena_, other.arena_);
+      std::swap(tree_, other.tree_);
       return *this;
     }
     ~IniParserResult() noexcept {}
 
-    bool has_member(std::string name) {
-      for (auto node : roots_)
-	if (node.has_member(name))
-	  return true;
-
-      return false;
+    bool has_member(std::string_view name) const noexcept {
+      return find(name) != nullptr;
     }
 
-    IniParserTreeLeaf operator [](const std::string name) const {
-      for (auto node : roots_) {
-	try {
-	  auto child = node[name];
-	  return child;
-	} catch (std::runtime_error const& ex) {
-	  continue;
-	}
-      }
+    const IniParserTreeLeaf& operator [](std::string_view name) const {
+      if (auto child = find(name))
+	return *child;
 
       throw std::runtime_error("libini error: member not found");
     } 
 
+    /*
+     * Looks up a member without throwing. The name is either a bare key, which resolves to
+     * the first section that has it, or a qualified 'section.key'. Returns nullptr if there is none.
+     */
+    const IniParserTreeLeaf* find(std::string_view name) const noexcept {
+      if (!tree_)
+	return nullptr;
+
+      auto position = find_key(name);
+
+      if (position == IniFlatIndex::npos)
+	position = tree_->qualified_keys.find(hash_name(name), [this, name](std::uint32_t i) {
+	  std::string_view section = tree_->roots[tree_->entries[i].node].get_name();
+	  std::string_view key = leaf(tree_->entries[i]).get_name();
+	  return name.size() == section.size() + 1 + key.size()
+	    && name.starts_with(section) && name[section.size()] == '.' && name.ends_with(key);
+	});
+
+      return position == IniFlatIndex::npos ? nullptr : &leaf(tree_->entries[position]);
+    }
+
+    // Looks up a member of a specific section without throwing. Returns nullptr if there is none.
+    const IniParserTreeLeaf* find(std::string_view section, std::string_view key) const noexcept {
+      if (!tree_)
+	return nullptr;
+
+      auto position = tree_->qualified_keys.find(qualified_hash(section, key), [this, section, key](std::uint32_t i) {
+	return tree_->roots[tree_->entries[i].node].get_name() == section && leaf(tree_->entries[i]).get_name() == key;
+      });
+
+      return position == IniFlatIndex::npos ? nullptr : &leaf(tree_->entries[position]);
+    }
+
     template<typename T>
     requires ParsableToken<T>
-    T::value_type get_value(const std::string name) const {
-      return (*this)[name].get_value<T>();
+    const T::value_type& get_value(std::string_view name) const {
+      if (auto child = find(name))
+	return child->get_value<T>();
+
+      throw std::runtime_error("libini error: member not found");
+    }
+
+    /*
+     * A string value as a view, valid as long as the result. String values are allocated from the result's
+     * arena as std::pmr::string, which does not convert to std::string; this works with either.
+     */
+    std::string_view get_string(std::string_view name) const {
+      return (*this)[name].get_string();
+    }
+
+    // The sections, in the order of the file.
+    IniParserRoots::const_iterator begin() const noexcept {
+      return tree_ ? tree_->roots.begin() : IniParserRoots::const_iterator{};
+    }
+
+    IniParserRoots::const_iterator end() const noexcept {
+      return tree_ ? tree_->roots.end() : IniParserRoots::const_iterator{};
+    }
+
+    std::size_t size() const noexcept {
+      return tree_ ? tree_->roots.size() : 0;
+    }
+
+    private:
+    template<typename LexerType>
+    requires IniTokenizer<LexerType>
+    friend class IniParser;
+
+    // Where a leaf lives in the tree. Positions rather than pointers keep copies valid.
+    struct Entry {
+      std::uint32_t node;
+      std::uint32_t leaf;
+    };
+
+    // A stretch of the file starting at a section header, as seen by the last reparse.
+    struct Block {
+      std::uint64_t hash;
+      std::size_t length;
+      // Number of sections parsed from it, normally one.
+      std::uint32_t nodes;
+    };
+
+    // Everything the result holds. It lives in the arena and is never destroyed,
+    // since all of its memory comes from the arena as well.
+    struct Tree {
+      Tree(const IniAllocator& allocator) noexcept
+	: roots(allocator), entries(allocator), keys(allocator), qualified_keys(allocator), blocks(allocator) {}
+
+      // A copy is compacted, it has no stale memory.
+      Tree(const Tree& other, const IniAllocator& allocator)
+	: roots(other.roots, allocator), entries(other.entries, allocator),
+	  keys(other.keys, allocator), qualified_keys(other.qualified_keys, allocator),
+	  blocks(other.blocks, allocator), filled(other.filled) {}
+
+      IniParserRoots roots;
+      std::pmr::vector<Entry> entries;
+      IniFlatIndex keys;
+      IniFlatIndex qualified_keys;
+      // Empty unless the tree came from a reparse.
+      std::pmr::vector<Block> blocks;
+      // Bytes of the arena when a reparse last filled it from scratch, and bytes reparses have
+      // added since. Everything a reparse allocates outlives the tree it replaces, so all of it counts.
+      std::size_t filled = 0;
+      std::size_t stale = 0;
+    };
+
+    std::unique_ptr<IniArena> arena_;
+    Tree* tree_;
+
+    // An empty result, to be filled in by the parser.
+    IniParserResult() noexcept
+      : arena_{std::make_unique<IniArena>()},
+	tree_{make_tree()} {}
+
+    // Constructs a tree in the arena.
+    template<typename... Args>
+    Tree* make_tree(const Args&... args) {
+      IniAllocator allocator{arena_.get()};
+      return allocator.new_object<Tree>(args..., allocator);
+    }
+
+    static std::uint64_t qualified_hash(std::string_view section, std::string_view key) noexcept {
+      return hash_name(key, hash_name(".", hash_name(section)));
+    }
+
+    // Position of the entry for a bare key, or npos.
+    std::uint32_t find_key(std::string_view name) const noexcept {
+      return tree_->keys.find(hash_name(name), [this, name](std::uint32_t i) {
+	return leaf(tree_->entries[i]).get_name() == name;
+      });
+    }
+
+    const IniParserTreeLeaf& leaf(Entry entry) const noexcept {
+      return tree_->roots[entry.node].begin()[entry.leaf];
+    }
+
+    /*
+     * Indexes every leaf under both its bare and its qualified name.
+     * Earlier sections win, so lookups keep their front-to-back semantics.
+     */
+    void build_index() {
+      const auto& roots = tree_->roots;
+
+      std::size_t leaves = 0;
+      for (const auto& node : roots)
+	leaves += node.size();
+
+      tree_->keys.reserve(leaves);
+      tree_->qualified_keys.reserve(leaves);
+
+      for (std::uint32_t n = 0; n < roots.size(); n++) {
+	const auto& node = roots[n];
+	// Every qualified name in the section starts the same, so that part is hashed once.
+	auto prefix = hash_name(".", hash_name(node.get_name()));
+
+	for (std::uint32_t l = 0; l < node.size(); l++) {
+	  const auto& name = node.begin()[l].get_name();
+	  auto hash = hash_name(name);
+	  auto qualified = hash_name(name, prefix);
+	  auto position = static_cast<std::uint32_t>(tree_->entries.size());
+	  bool indexed = false;
+
+	  if (tree_->keys.find(hash, [this, name](std::uint32_t i) { return leaf(tree_->entries[i]).get_name() == name; })
+	      == IniFlatIndex::npos) {
+	    tree_->keys.insert(hash, position);
+	    indexed = true;
+	  }
+
+	  if (tree_->qualified_keys.find(qualified, [this, &node, name](std::uint32_t i) {
+	    return tree_->roots[tree_->entries[i].node].get_name() == node.get_name() && leaf(tree_->entries[i]).get_name() == name;
+	  }) == IniFlatIndex::npos) {
+	    tree_->qualified_keys.insert(qualified, position);
+	    indexed = true;
+	  }
+
+	  if (indexed)
+	    tree_->entries.push_back({n, l});
+	}
+      }
+    }
+  };
+
+  /*
+   * Read-only cursor over an already tokenized stream.
+   * The parser only ever looks at the next token, so this is all it needs.
+   */
+  template<typename Tokens>
+  class IniTokenCursor {
+    public:
+    using value_type = typename Tokens::value_type;
+
+    IniTokenCursor(const Tokens& tokens) noexcept
+      : it_(tokens.begin()), end_(tokens.end()) {}
+
+    // The next token, or nullptr at the end of the stream.
+    const value_type* peek() const noexcept {
+      return it_ == end_ ? nullptr : &*it_;
+    }
+
+    void advance() noexcept {
+      ++it_;
     }
 
     private:
-    IniParserRoots roots_;
+    typename Tokens::const_iterator it_;
+    typename Tokens::const_iterator end_;
+  };
+
+  /*
+   * Cursor that pulls tokens from the lexer state machine as the parser asks for them,
+   * so the token stream is never materialized.
+   */
+  template<typename StringType>
+  class IniStreamCursor {
+    public:
+    using value_type = BasicIniVariant<StringType>;
+
+    IniStreamCursor(IniTokenStream stream) noexcept
+      : stream_(stream), current_(stream_.next<StringType>()) {}
+
+    // The next token, or nullptr at the end of the stream.
+    const value_type* peek() const noexcept {
+      return current_ ? &*current_ : nullptr;
+    }
+
+    void advance() noexcept {
+      current_ = stream_.next<StringType>();
+    }
+
+    private:
+    IniTokenStream stream_;
+    std::optional<value_type> current_;
+  };
+
+  /*
+   * Receives the contents of a file as it is being parsed, without building a tree.
+   * Names and values borrow from the lexer's buffer and are only valid during the call.
+   * After on_error, parsing resumes at the next section.
+   */
+  template<typename T>
+  concept IniEventHandler = requires(T handler, std::string_view text, const IniVariantView& value) {
+    handler.on_section(text);
+    handler.on_key_value(text, value);
+    handler.on_comment(text);
+    handler.on_error(text);
+  };
+
+  /*
+   * Event handler that builds the parse tree. Errors are fatal.
+   */
+  class IniTreeBuilder {
+    public:
+    IniTreeBuilder(IniParserRoots& roots) noexcept
+      : roots_(roots) {}
+
+    // Nodes and leaves are constructed in place with the allocator of the roots.
+    void on_section(std::string_view name) {
+      roots_.emplace_back(name);
+    }
+
+    template<typename StringType>
+    void on_key_value(std::string_view key, const BasicIniVariant<StringType>& value) {
+      roots_.back().insert(key, value);
+    }
+
+    void on_comment(std::string_view) noexcept {}
+
+    [[noreturn]] void on_error(std::string_view message) {
+      throw std::runtime_error(std::string(message));
+    }
+
+    private:
+    IniParserRoots& roots_;
+  };
+
+  /*
+   * Keeps compiled results of text parsed before, such as IniParseCache. load() hands back
+   * something that can replay the tree to an event handler, or nothing if the text is not cached.
+   */
+  template<typename Cache>
+  concept IniResultCache = requires(const Cache& cache, std::string_view text, const IniParserResult& result,
+				    IniTreeBuilder& builder) {
+    { cache.load(text).has_value() } -> std::convertible_to<bool>;
+    cache.load(text)->replay(builder);
+    cache.store(text, result);
   };
 
   template<typename LexerType = IniLexer>
@@ -187,117 +635,498 @@ namespace libini {
   class IniParser {
     public:
     IniParser(const std::string file_name) noexcept
-      : lexer_{file_name} {}
+      : state_{std::make_shared<State>(file_name)} {}
+
+    // Avoids string literals being mistaken for text.
+    IniParser(const char* file_name) noexcept
+      : IniParser(std::string(file_name)) {}
+
+    // Parses text in memory without copying it. It must outlive the parser and any pending parse.
+    IniParser(std::string_view text) noexcept
+    requires std::constructible_from<LexerType, std::string_view>
+      : state_{std::make_shared<State>(text)} {}
+
+    // Same as above, for raw bytes.
+    IniParser(std::span<const std::byte> bytes) noexcept
+    requires std::constructible_from<LexerType, std::span<const std::byte>>
+      : state_{std::make_shared<State>(bytes)} {}
+
+    // Reads the whole stream up front, it is not needed afterwards.
+    IniParser(std::istream& input)
+    requires std::constructible_from<LexerType, std::istream&>
+      : state_{std::make_shared<State>(input)} {}
 
     IniParserResult operator() () {
       return parse();
     }
 
     IniParserResult parse() {
-      return IniParserResult(build_tree());
+      return parse(*state_);
     }
 
-    std::future<IniParserResult> parse_async() {
-      std::promise<IniParserResult> promise;
-      std::future<IniParserResult> f = promise.get_future();
-      std::thread([this](auto p){ p.set_value(parse()); }, std::move(promise)).detach();
+    /*
+     * Parses the file through the cache. When the same text was parsed before, the tree is
+     * rebuilt from the cached result without lexing; otherwise the result is stored for next time.
+     * The file is read once, so the key and the tree always describe the same text.
+     */
+    template<typename Cache>
+    requires IniResultCache<Cache> && IniStreamingTokenizer<LexerType>
+    IniParserResult parse(const Cache& cache) {
+      std::lock_guard lock{state_->mutex};
+      auto stream = state_->lexer.stream();
+      auto text = stream.remaining();
+
+      IniParserResult result;
+      IniTreeBuilder builder{result.tree_->roots};
+      auto cached = cache.load(text);
+
+      if (cached) {
+	cached->replay(builder);
+      } else {
+	IniStreamCursor<std::string_view> cursor{stream};
+	parse_section(cursor, builder);
+      }
+
+      result.build_index();
+      if (!cached)
+	cache.store(text, result);
+
+      return result;
+    }
+
+    /*
+     * Parses the file without building a tree, reporting its contents to the handler instead.
+     * Tokens are pulled from the lexer one at a time, so memory use does not grow with the file.
+     */
+    template<typename Handler>
+    requires IniEventHandler<Handler> && IniStreamingTokenizer<LexerType>
+    void parse(Handler& handler) {
+      std::lock_guard lock{state_->mutex};
+      auto stream = state_->lexer.stream();
+      stream.keep_comments(true);
 
-      return f;
+      IniStreamCursor<std::string_view> cursor{stream};
+      parse_section(cursor, handler);
+    }
+
+    /*
+     * Parses the file in parallel. The file is cut into chunks at section headers,
+     * then each chunk is lexed and parsed on its own thread and the sections are merged in order.
+     * A line starting with '[' inside a quoted string spanning several lines would be mistaken for a header.
+     */
+    template<typename Executor = IniThreadPool>
+    requires IniExecutor<Executor> && IniStreamingTokenizer<LexerType>
+    IniParserResult parse_parallel(Executor& executor = IniThreadPool::shared(),
+				   std::size_t threads = std::thread::hardware_concurrency()) {
+      std::lock_guard lock{state_->mutex};
+
+      IniParserResult result;
+      auto chunks = split_sections(state_->lexer.stream().remaining(), std::max<std::size_t>(threads, 1));
+
+      // Every chunk builds its nodes with the result's allocator, in a region of the arena of its own.
+      std::vector<IniParserRoots> parts;
+      parts.reserve(chunks.size());
+      for (std::size_t i = 0; i < chunks.size(); i++)
+	parts.emplace_back(result.tree_->roots.get_allocator());
+
+      std::vector<std::exception_ptr> errors(chunks.size());
+
+      parallel_for(executor, chunks.size(), threads, [&](std::size_t i) {
+	IniArena::Region region{*result.arena_};
+	IniTreeBuilder builder{parts[i]};
+	IniTokenStream stream{chunks[i].data(), chunks[i].data() + chunks[i].size()};
+	IniStreamCursor<std::string_view> cursor{stream};
+
+	try {
+	  parse_section(cursor, builder);
+	} catch (...) {
+	  errors[i] = std::current_exception();
+	}
+      });
+
+      for (const auto& error : errors)
+	if (error)
+	  std::rethrow_exception(error);
+
+      // The allocators are equal, so the nodes are moved, not copied.
+      std::size_t size = 0;
+      for (const auto& part : parts)
+	size += part.size();
+
+      result.tree_->roots.reserve(size);
+      for (auto& part : parts)
+	std::move(part.begin(), part.end(), std::back_inserter(result.tree_->roots));
+
+      result.build_index();
+      return result;
+    }
+
+    /*
+     * Parses the file again, reusing what it can of the previous result of parsing it.
+     * The file is cut into blocks at lines starting with '[' and each block is hashed. Sections from
+     * unchanged blocks are moved over from the previous result, only the other blocks are parsed.
+     * The previous result is consumed, or left as it was if parsing throws. A result that did not
+     * come from reparse() has nothing to reuse, so the first reparse parses the whole file.
+     * As with parse_parallel(), a line starting with '[' inside a quoted string would be mistaken for a header.
+     */
+    IniParserResult reparse(IniParserResult&& previous)
+    requires IniStreamingTokenizer<LexerType> {
+      std::lock_guard lock{state_->mutex};
+
+      auto chunks = split_blocks(state_->lexer.stream().remaining());
+      std::size_t text_size = 0;
+      for (const auto& chunk : chunks)
+	text_size += chunk.size();
+
+      // Old blocks by hash, each reused at most once, and where their sections start.
+      std::unordered_multimap<std::uint64_t, std::size_t> old_blocks;
+      std::vector<std::size_t> old_first;
+      if (previous.tree_) {
+	std::size_t first = 0;
+	for (std::size_t i = 0; i < previous.tree_->blocks.size(); i++) {
+	  old_blocks.emplace(previous.tree_->blocks[i].hash, i);
+	  old_first.push_back(first);
+	  first += previous.tree_->blocks[i].nodes;
+	}
+      }
+
+      // The old block each chunk is the same as, or npos.
+      constexpr auto npos = std::numeric_limits<std::size_t>::max();
+      std::vector<std::uint64_t> hashes(chunks.size());
+      std::vector<std::size_t> reused(chunks.size(), npos);
+      std::size_t changed = 0;
+
+      for (std::size_t i = 0; i < chunks.size(); i++) {
+	hashes[i] = hash_content(chunks[i]);
+	auto [begin, end] = old_blocks.equal_range(hashes[i]);
+	auto match = std::find_if(begin, end, [&](const auto& block) {
+	  return previous.tree_->blocks[block.second].length == chunks[i].size();
+	});
+
+	if (match != end) {
+	  reused[i] = match->second;
+	  old_blocks.erase(match);
+	} else {
+	  changed += chunks[i].size();
+	}
+      }
+
+      // Replaced sections, vectors and indexes stay in the arena until the result is destroyed.
+      // Once reparses have allocated as much as a tree from scratch took, start over in a fresh arena,
+      // so the arena stays within a small multiple of the tree. So does a change to most of the file.
+      IniParserResult fresh;
+      bool incremental = previous.tree_ && !previous.tree_->blocks.empty()
+	&& previous.tree_->stale <= previous.tree_->filled && changed <= text_size / 2;
+      auto& target = incremental ? previous : fresh;
+      auto before = target.arena_->size();
+      if (!incremental)
+	std::fill(reused.begin(), reused.end(), npos);
+
+      // Parse the changed blocks first, so a syntax error leaves the previous result intact.
+      auto allocator = target.tree_->roots.get_allocator();
+      std::vector<IniParserRoots> parts;
+      parts.reserve(chunks.size());
+
+      for (std::size_t i = 0; i < chunks.size(); i++) {
+	parts.emplace_back(allocator);
+	if (reused[i] != npos)
+	  continue;
+
+	IniTreeBuilder builder{parts.back()};
+	IniStreamCursor<std::string_view> cursor{IniTokenStream{chunks[i].data(), chunks[i].data() + chunks[i].size()}};
+	parse_section(cursor, builder);
+      }
+
+      // The allocators are equal, so the nodes are moved, not copied.
+      auto& tree = *target.tree_;
+      IniParserRoots roots{allocator};
+      std::pmr::vector<IniParserResult::Block> blocks{allocator};
+      blocks.reserve(chunks.size());
+
+      for (std::size_t i = 0; i < chunks.size(); i++) {
+	auto first = std::make_move_iterator(parts[i].begin());
+	auto last = std::make_move_iterator(parts[i].end());
+
+	if (reused[i] != npos) {
+	  first = std::make_move_iterator(tree.roots.begin() + static_cast<std::ptrdiff_t>(old_first[reused[i]]));
+	  last = first + tree.blocks[reused[i]].nodes;
+	}
+
+	blocks.push_back({hashes[i], chunks[i].size(), static_cast<std::uint32_t>(last - first)});
+	roots.insert(roots.end(), first, last);
+      }
+
+      tree.roots = std::move(roots);
+      tree.blocks = std::move(blocks);
+      tree.entries.clear();
+      tree.keys.clear();
+      tree.qualified_keys.clear();
+      target.build_index();
+
+      if (incremental)
+	tree.stale += target.arena_->size() - before;
+      else
+	tree.filled = target.arena_->size();
+      return std::move(target);
+    }
+
+    /*
+     * Parses the file on the executor. The task shares ownership of the lexer,
+     * so the parser may be destroyed before the future is ready.
+     */
+    template<typename Executor>
+    requires IniExecutor<Executor>
+    std::future<IniParserResult> parse_async(Executor& executor) {
+      auto task = std::make_shared<std::packaged_task<IniParserResult()>>([state = state_] {
+	return parse(*state);
+      });
+
+      auto future = task->get_future();
+      executor.post([task] { (*task)(); });
+      return future;
+    }
+
+    // Same as above, on the shared pool.
+    std::future<IniParserResult> parse_async() {
+      return parse_async(IniThreadPool::shared());
     }
 
     private:
-    LexerType lexer_;
+    // The lexer and the lock serializing parses that use it, shared with pending async parses.
+    struct State {
+      template<typename Input>
+      State(Input&& input)
+	: lexer{std::forward<Input>(input)} {}
 
-    IniParserRoots build_tree() {
-      IniParserRoots roots;
-      std::pmr::monotonic_buffer_resource mbr;
-      std::pmr::polymorphic_allocator<IniVariant> allocator{&mbr};
-      auto tokens = lexer_(allocator);
+      std::mutex mutex;
+      LexerType lexer;
+    };
+
+    std::shared_ptr<State> state_;
 
-      parse_section(tokens, roots);
+    // Thrown by the parser to unwind to the section loop, which reports it to the handler.
+    struct IniSyntaxError {};
 
-      return roots;
+    static IniParserResult parse(State& state) {
+      std::lock_guard lock{state.mutex};
+
+      IniParserResult result;
+      build_tree(state.lexer, result.tree_->roots);
+      result.build_index();
+      return result;
     }
 
-    IniVariant parse_value(auto &tokens, auto &iter) {
-      auto type_index = (*iter).index();
+    /*
+     * Cuts the text into about the given number of chunks, each starting at a line beginning with '['.
+     * Only the text around the ideal cut points is scanned.
+     */
+    static std::vector<std::string_view> split_sections(std::string_view text, std::size_t count) {
+      std::vector<std::string_view> chunks;
+      std::size_t first = 0;
 
-      if (type_index >= 8) {
-	auto result = *(++iter);
-	remove_head(tokens);
-	return result;
-      } else if (type_index == 1) {
-	auto result = *iter;
-	remove_head(tokens, 1);
-	return result;
-      } else throw std::bad_variant_access();
+      for (std::size_t i = 1; i < count && first < text.size(); i++) {
+	auto cut = text.find("\n[", std::max(first, text.size() / count * i));
+	if (cut == std::string_view::npos)
+	  break;
+
+	chunks.push_back(text.substr(first, cut + 1 - first));
+	first = cut + 1;
+      }
+
+      chunks.push_back(text.substr(first));
+      return chunks;
+    }
+
+    // Cuts the text before every line starting with '['.
+    static std::vector<std::string_view> split_blocks(std::string_view text) {
+      std::vector<std::string_view> blocks;
+      std::size_t first = 0;
+
+      for (auto cut = text.find("\n["); cut != std::string_view::npos; cut = text.find("\n[", first)) {
+	blocks.push_back(text.substr(first, cut + 1 - first));
+	first = cut + 1;
+      }
+
+      blocks.push_back(text.substr(first));
+      return blocks;
     }
 
-    void parse_member(auto &tokens, auto &node) {
-      auto len = tokens.size();
+    static void build_tree(LexerType& lexer, IniParserRoots& roots) {
+      IniTreeBuilder builder{roots};
 
-      if (len < 3)
+      if constexpr (IniStreamingTokenizer<LexerType>) {
+	// Pull one token at a time, building nodes as we go.
+	IniStreamCursor<std::string_view> cursor{lexer.stream()};
+	parse_section(cursor, builder);
 	return;
-      
-      IniTokens::iterator it = tokens.begin();
-      if ((*it).index() == 5)
-	      return;
+      }
 
-      try {
-	auto identifier = std::get<IniIdentifier>(*it);
-	auto equals = std::get<IniEquals>(*(++it));
-	auto value = parse_value(tokens, (++it));
-	auto leaf = IniParserTreeLeaf(identifier.token_value, value);
+      if constexpr (IniViewTokenizer<LexerType>) {
+	// Borrow names and values from the lexer's buffer, they are only copied into the tree.
+	std::pmr::monotonic_buffer_resource mbr;
+	std::pmr::polymorphic_allocator<IniVariantView> allocator{&mbr};
+	auto tokens = lexer.tokenize_view(allocator);
+	IniTokenCursor cursor{tokens};
+	parse_section(cursor, builder);
+      } else {
+	std::pmr::monotonic_buffer_resource mbr;
+	std::pmr::polymorphic_allocator<IniVariant> allocator{&mbr};
+	auto tokens = lexer(allocator);
+	IniTokenCursor cursor{tokens};
+	parse_section(cursor, builder);
+      }
+    }
+
+    /*
+     * Parses the whole token stream in a single front-to-back pass.
+     * Iterative, so stack usage does not depend on the number of sections or members.
+     */
+    template<typename Cursor, typename Handler>
+    static void parse_section(Cursor &cursor, Handler &handler) {
+      using StringType = ini_string_type_t<typename Cursor::value_type>;
 
-	remove_head(tokens, 2);
-	node.insert(leaf);
+      while (peek(cursor, handler)) {
+	try {
+	  // Found beginning of section, parse it
+	  expect<IniLBrace>(cursor, handler);
+	  handler.on_section(expect<BasicIniSection<StringType>>(cursor, handler).token_value);
+	  skip<IniRBrace>(cursor, handler);
 
-	if (tokens.size() > 2)
-	  parse_member(tokens, node);
+	  for (auto token = peek(cursor, handler); token && !std::holds_alternative<IniLBrace>(*token); token = peek(cursor, handler))
+	    parse_member(cursor, handler);
+	} catch (IniSyntaxError const&) {
+	  handler.on_error("libini error: parser encountered unexpected token while parsing section.");
 
-      } catch (std::bad_variant_access const& ex) {
-	throw ex;
+	  // Resynchronize at the next section.
+	  for (auto token = peek(cursor, handler); token && !std::holds_alternative<IniLBrace>(*token); token = peek(cursor, handler))
+	    cursor.advance();
+	}
       }
+    }
+
+    template<typename Cursor, typename Handler>
+    static void parse_member(Cursor &cursor, Handler &handler) {
+      using StringType = ini_string_type_t<typename Cursor::value_type>;
+
+      auto identifier = expect<BasicIniIdentifier<StringType>>(cursor, handler);
+      expect<IniEquals>(cursor, handler);
+      handler.on_key_value(identifier.token_value, parse_value(cursor, handler));
     } 
 
-    void parse_section(auto &tokens, IniParserRoots &roots) {
-      auto len = tokens.size();
+    template<typename Cursor, typename Handler>
+    static Cursor::value_type parse_value(Cursor &cursor, Handler &handler) {
+      using StringType = ini_string_type_t<typename Cursor::value_type>;
+      auto token = peek(cursor, handler);
 
-      if (len == 0)
-	return;
+      if (token && (std::holds_alternative<IniInteger>(*token) || std::holds_alternative<IniFloat>(*token))) {
+	auto result = *token;
+	cursor.advance();
+	return result;
+      }
 
-      try {
-	auto head = std::get<IniLBrace>(tokens.front()).token_type;
-
-	if (head == TokenType::LBrace) { // Found beginning of section, parse it
-	  IniTokens::iterator it = tokens.begin();
-	  auto section = std::get<IniSection>(*(++it)); // Get the section
-	  remove_head(tokens);
-
-	  auto node = IniParserTreeNode(section);
-	
-	  parse_member(tokens, node);
-	  roots.push_back(node);
-
-	  parse_section(tokens, roots);
-	  return;
-	} 
-
-	throw std::runtime_error("libini error: parser encountered unexpected token while parsing section.");
-      } catch (std::bad_variant_access const& ex) {
-	throw std::runtime_error("libini error: parser encountered unexpected token while parsing section.");
-      } catch (std::runtime_error const& ex) {
-	throw ex;
+      // Otherwise it must be a quoted string.
+      if (!skip<IniSingleQuote>(cursor, handler) && !skip<IniDoubleQuote>(cursor, handler))
+	throw IniSyntaxError();
+
+      typename Cursor::value_type result = expect<BasicIniString<StringType>>(cursor, handler);
+      if (!skip<IniSingleQuote>(cursor, handler))
+	skip<IniDoubleQuote>(cursor, handler);
+
+      return result;
+    }
+
+    // The next token, reporting any comments in front of it to the handler.
+    template<typename Cursor, typename Handler>
+    static const Cursor::value_type* peek(Cursor &cursor, Handler &handler) {
+      using StringType = ini_string_type_t<typename Cursor::value_type>;
+      auto token = cursor.peek();
+
+      while (token && std::holds_alternative<BasicIniComment<StringType>>(*token)) {
+	handler.on_comment(std::get<BasicIniComment<StringType>>(*token).token_value);
+	cursor.advance();
+	token = cursor.peek();
       }
+
+      return token;
     }
 
-    void remove_head(auto &tokens, int limit = 3) noexcept {
-	for (int i = 0; i < limit; i++) 
-	  if (!tokens.empty()) {
-	    tokens.pop_front();
-	  }
+    // Consumes a token of the given type, or throws if the next token is something else.
+    template<typename Token, typename Cursor, typename Handler>
+    static Token expect(Cursor &cursor, Handler &handler) {
+      auto token = peek(cursor, handler);
+      if (!token || !std::holds_alternative<Token>(*token))
+	throw IniSyntaxError();
+
+      Token result = std::get<Token>(*token);
+      cursor.advance();
+      return result;
+    }
+
+    // Consumes a token of the given type if it is next.
+    template<typename Token, typename Cursor, typename Handler>
+    static bool skip(Cursor &cursor, Handler &handler) {
+      auto token = peek(cursor, handler);
+      if (!token || !std::holds_alternative<Token>(*token))
+	return false;
+
+      cursor.advance();
+      return true;
     }
   };
+
+  // Queues a parse of every file on the executor. Calling get() on each future waits for all of them.
+  template<typename LexerType = IniLexer, typename Executor = IniThreadPool>
+  requires IniTokenizer<LexerType> && IniExecutor<Executor>
+  std::vector<std::future<IniParserResult>> parse_async(std::span<const std::string> file_names,
+							 Executor& executor = IniThreadPool::shared()) {
+    std::vector<std::future<IniParserResult>> futures;
+    futures.reserve(file_names.size());
+
+    for (const auto& file_name : file_names)
+      futures.push_back(IniParser<LexerType>{file_name}.parse_async(executor));
+
+    return futures;
+  }
+
+  // One file of a batch: its tree, or the error that stopped it.
+  struct IniParseOutcome {
+    std::filesystem::path path;
+    std::optional<IniParserResult> result;
+    std::string error;
+
+    bool ok() const noexcept {
+      return result.has_value();
+    }
+  };
+
+  /*
+   * Parses every file, spread over the executor's threads and the calling thread.
+   * Each thread claims the next unparsed file, so a thread stuck on a large file does not
+   * hold up the rest and the batch takes about as long as its largest file.
+   * Outcomes are returned in input order. A failing file does not stop the others.
+   */
+  template<typename LexerType = IniLexer, typename Executor = IniThreadPool>
+  requires IniTokenizer<LexerType> && IniExecutor<Executor>
+  std::vector<IniParseOutcome> parse_all(std::span<const std::filesystem::path> paths,
+					 Executor& executor = IniThreadPool::shared(),
+					 std::size_t threads = std::thread::hardware_concurrency()) {
+    std::vector<IniParseOutcome> outcomes(paths.size());
+
+    parallel_for(executor, paths.size(), threads, [paths, &outcomes](std::size_t i) {
+      auto& outcome = outcomes[i];
+      outcome.path = paths[i];
+
+      try {
+	outcome.result.emplace(IniParser<LexerType>{outcome.path.string()}.parse());
+      } catch (const std::exception& e) {
+	outcome.error = e.what();
+      } catch (...) {
+	outcome.error = "libini error: unknown error while parsing file.";
+      }
+    });
+
+    return outcomes;
+  }
 };
 
 #endif
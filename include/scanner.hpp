@@ -0,0 +1,76 @@
+#ifndef SCANNER_HPP_
+#define SCANNER_HPP_
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <span>
+
+namespace libini {
+
+  /*
+   * A character class backed by a 256-entry lookup table built at compile time,
+   * so testing a character is a single table load.
+   */
+  class IniCharClass {
+  public:
+    constexpr IniCharClass() noexcept = default;
+
+    // Builds the table by evaluating the predicate for every byte value.
+    template<typename Predicate>
+    requires std::predicate<Predicate, char>
+    static constexpr IniCharClass from(Predicate predicate) noexcept {
+      IniCharClass result;
+      for (std::size_t i = 0; i < result.table_.size(); i++)
+	result.table_[i] = predicate(static_cast<char>(i));
+      return result;
+    }
+
+    constexpr bool contains(char c) const noexcept {
+      return table_[static_cast<unsigned char>(c)];
+    }
+
+    constexpr bool operator ()(char c) const noexcept {
+      return contains(c);
+    }
+
+  protected:
+    std::array<bool, 256> table_{};
+  };
+
+  /*
+   * A small set of delimiter characters. Besides testing single characters,
+   * it can search a buffer for the next member (or non-member) in bulk,
+   * 16 or 32 bytes at a time when SSE2/AVX2 is available.
+   */
+  class IniCharSet : public IniCharClass {
+  public:
+    static constexpr std::size_t capacity = 8;
+
+    constexpr IniCharSet() noexcept = default;
+
+    template<typename... Chars>
+    requires (std::same_as<Chars, char> && ...) && (sizeof...(Chars) <= capacity)
+    constexpr IniCharSet(Chars... chars) noexcept
+      : chars_{chars...}, size_(sizeof...(Chars)) {
+      ((table_[static_cast<unsigned char>(chars)] = true), ...);
+    }
+
+    // The characters in the set, used by the vectorized scans.
+    constexpr std::span<const char> members() const noexcept {
+      return {chars_.data(), size_};
+    }
+
+    // Returns the first character in [first, last) that is in the set, or last.
+    const char* find(const char* first, const char* last) const noexcept;
+
+    // Returns the first character in [first, last) that is not in the set, or last.
+    const char* find_not(const char* first, const char* last) const noexcept;
+
+  private:
+    std::array<char, capacity> chars_{};
+    std::size_t size_ = 0;
+  };
+};
+
+#endif
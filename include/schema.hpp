@@ -0,0 +1,244 @@
+#ifndef SCHEMA_HPP_
+#define SCHEMA_HPP_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "index.hpp"
+#include "parser.hpp"
+#include "tokens.hpp"
+
+namespace libini {
+
+  /*
+   * Perfect hash over a fixed set of names, built at compile time by hash and displace.
+   * The names are spread over buckets, then each bucket, fullest first, gets the first seed
+   * that puts all of its names in free slots. A lookup hashes the name once and compares
+   * it with a single candidate.
+   */
+  template<std::size_t N>
+  class IniPerfectHash {
+  public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    // Throws, failing compilation when evaluated at compile time, if a name appears twice.
+    constexpr IniPerfectHash(const std::array<std::string_view, N>& names)
+      : names_(names), seeds_{}, slots_{} {
+      for (std::size_t i = 0; i < N; i++)
+	for (std::size_t j = i + 1; j < N; j++)
+	  if (names_[i] == names_[j])
+	    throw std::logic_error("libini error: name appears twice.");
+
+      std::array<std::uint64_t, N> hashes{};
+      std::array<std::size_t, bucket_count + 1> first{};
+      for (std::size_t i = 0; i < N; i++) {
+	hashes[i] = hash_name(names_[i]);
+	first[bucket_of(hashes[i]) + 1]++;
+      }
+
+      // Group the names by bucket, first[b] is where bucket b starts.
+      for (std::size_t b = 0; b < bucket_count; b++)
+	first[b + 1] += first[b];
+
+      std::array<std::size_t, N> members{};
+      auto next = first;
+      for (std::size_t i = 0; i < N; i++)
+	members[next[bucket_of(hashes[i])]++] = i;
+
+      std::array<std::size_t, bucket_count> order{};
+      for (std::size_t b = 0; b < bucket_count; b++)
+	order[b] = b;
+      std::sort(order.begin(), order.end(), [&first](std::size_t a, std::size_t b) {
+	return first[a + 1] - first[a] > first[b + 1] - first[b];
+      });
+
+      for (auto bucket : order)
+	place(bucket, hashes, std::span<const std::size_t>{members}.subspan(first[bucket], first[bucket + 1] - first[bucket]));
+    }
+
+    // Position of the name in the set, or npos.
+    constexpr std::size_t find(std::string_view name) const noexcept {
+      auto hash = hash_name(name);
+      auto slot = slots_[slot_of(hash, seeds_[bucket_of(hash)])];
+
+      return slot != 0 && names_[slot - 1] == name ? slot - 1 : npos;
+    }
+
+    constexpr std::size_t size() const noexcept {
+      return N;
+    }
+
+  private:
+    // About two names per bucket and two slots per name keep the seeds small.
+    static constexpr std::size_t bucket_count = std::bit_ceil(std::max<std::size_t>(N / 2, 1));
+    static constexpr std::size_t slot_count = std::bit_ceil(std::max<std::size_t>(N * 2, 1));
+    static constexpr std::uint64_t max_seed = 1 << 16;
+
+    std::array<std::string_view, N> names_;
+    std::array<std::uint64_t, bucket_count> seeds_;
+    // Position of the name in each slot plus one, zero is empty.
+    std::array<std::size_t, slot_count> slots_;
+
+    static constexpr std::size_t bucket_of(std::uint64_t hash) noexcept {
+      return displace_bucket(hash, bucket_count);
+    }
+
+    // Each seed sends the names of a bucket to different slots.
+    static constexpr std::size_t slot_of(std::uint64_t hash, std::uint64_t seed) noexcept {
+      return displace_slot(hash, seed, slot_count);
+    }
+
+    /*
+     * Finds a seed that puts every name of the bucket in a free slot, and takes the slots.
+     */
+    constexpr void place(std::size_t bucket, const std::array<std::uint64_t, N>& hashes,
+			 std::span<const std::size_t> members) {
+      for (std::uint64_t seed = 0; seed < max_seed; seed++) {
+	std::size_t placed = 0;
+	for (; placed < members.size(); placed++) {
+	  auto slot = slot_of(hashes[members[placed]], seed);
+	  if (slots_[slot] != 0)
+	    break;
+
+	  slots_[slot] = members[placed] + 1;
+	}
+
+	if (placed == members.size()) {
+	  seeds_[bucket] = seed;
+	  return;
+	}
+
+	// Give back the slots taken with this seed.
+	for (std::size_t i = 0; i < placed; i++)
+	  slots_[slot_of(hashes[members[i]], seed)] = 0;
+      }
+
+      throw std::logic_error("libini error: no perfect hash found.");
+    }
+  };
+
+  // A string literal usable as a template argument, such as the name of a schema field.
+  template<std::size_t N>
+  struct IniName {
+    constexpr IniName(const char (&text)[N]) noexcept {
+      std::copy_n(text, N, value);
+    }
+
+    constexpr operator std::string_view() const noexcept {
+      return {value, N - 1};
+    }
+
+    char value[N];
+  };
+
+  // A field of a schema: a member name, qualified ('section.key') or bare, and the type of its value.
+  template<IniName Name, typename T>
+  requires ParsableToken<T>
+  struct IniField {
+    static constexpr std::string_view name = Name;
+    using type = T;
+  };
+
+  /*
+   * A configuration schema known at compile time. Binding a parse result to it looks every field up
+   * and checks its type once; after that, reading a field named at compile time is an index into
+   * an array of values, and a name that is not in the schema does not compile.
+   *
+   *   using Schema = IniSchema<IniField<"server.port", IniInteger>, IniField<"server.host", IniString>>;
+   *   auto config = Schema::bind(result);
+   *   auto port = config.get<"server.port">();
+   */
+  template<typename... Fields>
+  class IniSchema {
+  public:
+    static constexpr std::size_t npos = IniPerfectHash<sizeof...(Fields)>::npos;
+
+    // Position of a field by name, or npos. Usable at compile time.
+    static constexpr std::size_t find(std::string_view name) noexcept {
+      return hash_.find(name);
+    }
+
+    static constexpr std::size_t size() noexcept {
+      return sizeof...(Fields);
+    }
+
+    // The values of the fields in a parse result, which must outlive the binding.
+    class Binding {
+    public:
+      // Throws if a field is missing from the result, or holds a value of another type.
+      explicit Binding(const IniParserResult& result)
+	: values_{bind<Fields>(result)...} {}
+
+      template<IniName Name>
+      const auto& get() const noexcept {
+	constexpr auto position = find(Name);
+	static_assert(position != npos, "libini error: name is not in the schema.");
+
+	return *std::get<position>(values_);
+      }
+
+      // Same as above, for a name only known at runtime. Throws if it is not in the schema or is of another type.
+      template<typename T>
+      requires ParsableToken<T>
+      const T::value_type& get_value(std::string_view name) const {
+	auto position = find(name);
+	if (position == npos)
+	  throw std::runtime_error("libini error: member not found");
+
+	const typename T::value_type* value = nullptr;
+	[&]<std::size_t... I>(std::index_sequence<I...>) {
+	  ((I == position ? assign(value, std::get<I>(values_)) : void()), ...);
+	}(std::index_sequence_for<Fields...>{});
+
+	if (value == nullptr)
+	  throw std::bad_variant_access();
+
+	return *value;
+      }
+
+    private:
+      std::tuple<const typename Fields::type::value_type*...> values_;
+
+      template<typename Field>
+      static const typename Field::type::value_type* bind(const IniParserResult& result) {
+	auto leaf = result.find(Field::name);
+	if (leaf == nullptr)
+	  throw std::runtime_error("libini error: member not found");
+
+	if (!std::holds_alternative<typename Field::type>(leaf->get_variant()))
+	  throw std::runtime_error("libini error: member has the wrong type");
+
+	return &leaf->template get_value<typename Field::type>();
+      }
+
+      template<typename Value, typename Field>
+      static void assign(const Value*& value, const Field* field) noexcept {
+	if constexpr (std::same_as<Value, Field>)
+	  value = field;
+      }
+    };
+
+    static Binding bind(const IniParserResult& result) {
+      return Binding{result};
+    }
+
+  private:
+    static constexpr std::array<std::string_view, sizeof...(Fields)> names_{Fields::name...};
+    static constexpr IniPerfectHash<sizeof...(Fields)> hash_{names_};
+    // Builds the hash along with the class, so a schema naming a member twice does not compile.
+    static_assert(hash_.size() == sizeof...(Fields));
+  };
+};
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace libini {
+
+  // Anything that runs posted tasks at some later point, on some thread.
+  template<typename Executor>
+  concept IniExecutor = requires(Executor& executor, std::function<void()> task) {
+    executor.post(std::move(task));
+  };
+
+  /*
+   * A fixed number of worker threads draining a shared queue of tasks.
+   * Destroying the pool runs whatever is still queued, then joins the workers.
+   */
+  class IniThreadPool {
+  public:
+    // Starts the given number of workers, at least one.
+    explicit IniThreadPool(std::size_t threads = std::thread::hardware_concurrency());
+
+    ~IniThreadPool() noexcept;
+
+    // A pool owns its threads, it can be neither copied nor moved.
+    IniThreadPool(const IniThreadPool& other) = delete;
+    IniThreadPool& operator =(const IniThreadPool&) = delete;
+
+    // Queues a task. Exceptions escaping it are swallowed, use submit() to observe them.
+    void post(std::function<void()> task);
+
+    // Queues a callable and returns a future for its result or exception.
+    template<typename Function>
+    requires std::invocable<Function>
+    std::future<std::invoke_result_t<Function>> submit(Function&& function) {
+      using Result = std::invoke_result_t<Function>;
+
+      auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+      auto future = task->get_future();
+      post([task] { (*task)(); });
+      return future;
+    }
+
+    // Blocks until the queue is empty and no task is running.
+    void wait();
+
+    std::size_t size() const noexcept;
+
+    // Process-wide pool, sized to the hardware and started on first use.
+    static IniThreadPool& shared();
+
+  private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable idle_;
+    std::size_t active_;
+    bool stopping_;
+
+    /*
+     * Worker loop. Takes tasks off the queue until the pool is stopping and the queue is empty.
+     */
+    void work() noexcept;
+  };
+
+  /*
+   * Calls work(i) for every i below count, on the calling thread and up to threads - 1 helpers posted
+   * to the executor. Each thread claims the next index from a shared counter, so a thread held up by
+   * a slow item does not hold up the others. Returns once every call has returned, without waiting
+   * for helpers that have not started yet; those find nothing left to claim. work must not throw.
+   */
+  template<typename Executor, typename Work>
+  requires IniExecutor<Executor> && std::invocable<Work&, std::size_t>
+  void parallel_for(Executor& executor, std::size_t count, std::size_t threads, Work work) {
+    // Shared with the helpers, which may outlive the call.
+    struct Batch {
+      Work work;
+      std::size_t count;
+      std::atomic<std::size_t> next{0};
+      std::atomic<std::size_t> done{0};
+    };
+
+    auto batch = std::make_shared<Batch>(std::move(work), count);
+    auto claim = [](Batch& state) {
+      for (auto i = state.next.fetch_add(1); i < state.count; i = state.next.fetch_add(1)) {
+	state.work(i);
+	if (state.done.fetch_add(1) + 1 == state.count)
+	  state.done.notify_all();
+      }
+    };
+
+    for (std::size_t i = 1; i < std::min(threads, count); i++)
+      executor.post([batch, claim] { claim(*batch); });
+
+    claim(*batch);
+
+    for (auto done = batch->done.load(); done != count; done = batch->done.load())
+      batch->done.wait(done);
+  }
+};
+
+#endif
@@ -4,14 +4,19 @@
 #include <algorithm>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <variant>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <utility>
 
 namespace libini {
 
   // Strongly-typed Enum for representing token types of interest.
-  enum class TokenType {
+  enum class TokenType : std::uint8_t {
     LBrace,
     RBrace,
     Equals,
@@ -21,74 +26,169 @@ namespace libini {
     Identifier,
     String,
     Number,
+    Integer,
+    Float,
+    Comment,
     Null,
     EndOfFile,
   };
 
-  // Structure for representing numerical values.
-  struct IniNumber {
-    constexpr IniNumber(const float f) noexcept
-      : token_value(f) {}
-    constexpr IniNumber(const IniNumber& other) noexcept
+  // Structure for representing integral values, decimal or hexadecimal.
+  // Integers that do not fit in 64 bits are lexed as an IniFloat instead, and lose precision.
+  struct IniInteger {
+    constexpr IniInteger(const std::int64_t i) noexcept
+      : token_value(i) {}
+    constexpr IniInteger(const IniInteger& other) noexcept
       : token_value(other.token_value) {}
-    constexpr IniNumber& operator=(const IniNumber& other) noexcept {
+    constexpr IniInteger& operator=(const IniInteger& other) noexcept {
       if (this != &other)
 	token_value = other.token_value;
       return *this;
     }
-    static constexpr TokenType token_type = TokenType::Number;
-    float token_value;
-    using value_type = float;
+    static constexpr TokenType token_type = TokenType::Integer;
+    std::int64_t token_value;
+    using value_type = std::int64_t;
+  };
+
+  // Structure for representing floating point values. Values beyond the range of a double are infinite.
+  struct IniFloat {
+    constexpr IniFloat(const double d) noexcept
+      : token_value(d) {}
+    constexpr IniFloat(const IniFloat& other) noexcept
+      : token_value(other.token_value) {}
+    constexpr IniFloat& operator=(const IniFloat& other) noexcept {
+      if (this != &other)
+	token_value = other.token_value;
+      return *this;
+    }
+    static constexpr TokenType token_type = TokenType::Float;
+    double token_value;
+    using value_type = double;
   };
 
   // Structure for representing string values.
-  struct IniString {
-    IniString(const std::string str) noexcept
+  // StringType is std::pmr::string for owned tokens and std::string_view for tokens
+  // borrowing from the lexer's input buffer.
+  template<typename StringType>
+  struct BasicIniString {
+    BasicIniString(const StringType str) noexcept
       : token_value(str) {}
-    IniString(const IniString& other) noexcept
+    BasicIniString(const BasicIniString& other) noexcept
+      : token_value(other.token_value) {}
+    // Moving keeps the string's allocator.
+    BasicIniString(BasicIniString&& other) noexcept = default;
+    template<typename OtherType>
+    explicit BasicIniString(const BasicIniString<OtherType>& other) noexcept
       : token_value(other.token_value) {}
-    IniString& operator=(const IniString& other) noexcept {
+    // Constructs the value in place, e.g. from a view and an allocator.
+    template<typename... Args>
+    BasicIniString(std::in_place_t, Args&&... args)
+      : token_value(std::forward<Args>(args)...) {}
+    BasicIniString& operator=(const BasicIniString& other) noexcept {
       if (this != &other)
 	token_value = other.token_value;
       return *this;
     }
+    BasicIniString& operator=(BasicIniString&& other) noexcept = default;
     static constexpr TokenType token_type = TokenType::String;
-    std::string token_value;
-    using value_type = std::string;
+    StringType token_value;
+    using value_type = StringType;
   };
 
   // Structure for representing identifiers (variable names).
-  struct IniIdentifier {
-    IniIdentifier(const std::string str) noexcept
+  template<typename StringType>
+  struct BasicIniIdentifier {
+    BasicIniIdentifier(const StringType str) noexcept
       : token_value(str) {}
-    IniIdentifier(const IniIdentifier& other) noexcept
+    BasicIniIdentifier(const BasicIniIdentifier& other) noexcept
       : token_value(other.token_value) {};
-    IniIdentifier& operator=(const IniIdentifier& other) noexcept {
+    // Moving keeps the string's allocator.
+    BasicIniIdentifier(BasicIniIdentifier&& other) noexcept = default;
+    template<typename OtherType>
+    explicit BasicIniIdentifier(const BasicIniIdentifier<OtherType>& other) noexcept
+      : token_value(other.token_value) {}
+    // Constructs the value in place, e.g. from a view and an allocator.
+    template<typename... Args>
+    BasicIniIdentifier(std::in_place_t, Args&&... args)
+      : token_value(std::forward<Args>(args)...) {}
+    BasicIniIdentifier& operator=(const BasicIniIdentifier& other) noexcept {
       if (this != &other) 
 	token_value = other.token_value;
       return *this;
     }
+    BasicIniIdentifier& operator=(BasicIniIdentifier&& other) noexcept = default;
     static constexpr TokenType token_type = TokenType::Identifier;
-    std::string token_value;
-    using value_type = std::string;
+    StringType token_value;
+    using value_type = StringType;
   };
 
   // Structure for representing sections ([<name>]).
-  struct IniSection {
-    IniSection(const std::string str) noexcept
+  template<typename StringType>
+  struct BasicIniSection {
+    BasicIniSection(const StringType str) noexcept
       : token_value(str) {}
-    IniSection(const IniSection& other) noexcept
+    BasicIniSection(const BasicIniSection& other) noexcept
       : token_value(other.token_value) {}
-    IniSection& operator=(const IniSection& other) noexcept {
+    // Moving keeps the string's allocator.
+    BasicIniSection(BasicIniSection&& other) noexcept = default;
+    template<typename OtherType>
+    explicit BasicIniSection(const BasicIniSection<OtherType>& other) noexcept
+      : token_value(other.token_value) {}
+    // Constructs the value in place, e.g. from a view and an allocator.
+    template<typename... Args>
+    BasicIniSection(std::in_place_t, Args&&... args)
+      : token_value(std::forward<Args>(args)...) {}
+    BasicIniSection& operator=(const BasicIniSection& other) noexcept {
       if (this != &other)
 	token_value = other.token_value;
       return *this;
     }
+    BasicIniSection& operator=(BasicIniSection&& other) noexcept = default;
     static constexpr TokenType token_type = TokenType::Section;
-    std::string token_value;
-    using value_type = std::string;
+    StringType token_value;
+    using value_type = StringType;
   };
 
+  // Structure for representing comments (# <text>). Only produced when asked for.
+  template<typename StringType>
+  struct BasicIniComment {
+    BasicIniComment(const StringType str) noexcept
+      : token_value(str) {}
+    BasicIniComment(const BasicIniComment& other) noexcept
+      : token_value(other.token_value) {}
+    // Moving keeps the string's allocator.
+    BasicIniComment(BasicIniComment&& other) noexcept = default;
+    template<typename OtherType>
+    explicit BasicIniComment(const BasicIniComment<OtherType>& other) noexcept
+      : token_value(other.token_value) {}
+    // Constructs the value in place, e.g. from a view and an allocator.
+    template<typename... Args>
+    BasicIniComment(std::in_place_t, Args&&... args)
+      : token_value(std::forward<Args>(args)...) {}
+    BasicIniComment& operator=(const BasicIniComment& other) noexcept {
+      if (this != &other)
+	token_value = other.token_value;
+      return *this;
+    }
+    BasicIniComment& operator=(BasicIniComment&& other) noexcept = default;
+    static constexpr TokenType token_type = TokenType::Comment;
+    StringType token_value;
+    using value_type = StringType;
+  };
+
+  // Owned tokens, safe to keep around after the input is gone.
+  // Their strings are allocator-aware, so a parse result can keep them in its arena.
+  using IniString = BasicIniString<std::pmr::string>;
+  using IniIdentifier = BasicIniIdentifier<std::pmr::string>;
+  using IniSection = BasicIniSection<std::pmr::string>;
+  using IniComment = BasicIniComment<std::pmr::string>;
+
+  // Borrowed tokens, only valid while the lexer's input buffer is alive.
+  using IniStringView = BasicIniString<std::string_view>;
+  using IniIdentifierView = BasicIniIdentifier<std::string_view>;
+  using IniSectionView = BasicIniSection<std::string_view>;
+  using IniCommentView = BasicIniComment<std::string_view>;
+
   // Structure for representing null value. Valueless.
   struct IniNull {
     constexpr IniNull() noexcept = default;
@@ -126,11 +226,86 @@ namespace libini {
     static constexpr TokenType token_type = TokenType::SingleQuote;
   };
 
+  /*
+   * A token packed into 8 bytes: the type, and where its text is in the buffer it was read from.
+   * The text is only turned into a value when the token is read, see make_token().
+   */
+  class IniCompactToken {
+  public:
+    static constexpr std::size_t max_offset = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::size_t max_length = (std::size_t{1} << 24) - 1;
+
+    constexpr IniCompactToken(TokenType type, std::uint32_t offset, std::uint32_t length) noexcept
+      : offset_(offset), packed_(length << 8 | static_cast<std::uint8_t>(type)) {}
+
+    constexpr TokenType type() const noexcept {
+      return static_cast<TokenType>(packed_ & 0xff);
+    }
+
+    constexpr std::uint32_t offset() const noexcept {
+      return offset_;
+    }
+
+    constexpr std::uint32_t length() const noexcept {
+      return packed_ >> 8;
+    }
+
+    // The token's text, in the buffer it was read from.
+    constexpr std::string_view text(std::string_view buffer) const noexcept {
+      return buffer.substr(offset_, length());
+    }
+
+  private:
+    std::uint32_t offset_;
+    // Length in the upper 24 bits, type in the lower 8.
+    std::uint32_t packed_;
+  };
+
+  static_assert(sizeof(IniCompactToken) == 8);
+
   // Using std::variant to create a type-alias for all .ini tokens.
-  using IniVariant = std::variant<IniSection, IniNumber, IniString,
-				  IniIdentifier, IniNull, IniLBrace,
-				  IniRBrace, IniEquals, IniDoubleQuote,
-				  IniSingleQuote>;
+  template<typename StringType>
+  using BasicIniVariant = std::variant<BasicIniSection<StringType>, IniInteger, IniFloat, BasicIniString<StringType>,
+				       BasicIniIdentifier<StringType>, IniNull, IniLBrace,
+				       IniRBrace, IniEquals, IniDoubleQuote,
+				       IniSingleQuote, BasicIniComment<StringType>>;
+
+  using IniVariant = BasicIniVariant<std::pmr::string>;
+  using IniVariantView = BasicIniVariant<std::string_view>;
+
+  // The string type a token variant was instantiated with.
+  template<typename Variant>
+  struct ini_string_type;
+
+  template<typename StringType>
+  struct ini_string_type<BasicIniVariant<StringType>> {
+    using type = StringType;
+  };
+
+  template<typename Variant>
+  using ini_string_type_t = typename ini_string_type<Variant>::type;
+
+  // Copies a borrowed token into its owned form.
+  inline IniVariant to_owned(const IniVariantView& token) {
+    return std::visit([](const auto& t) -> IniVariant {
+      using T = std::decay_t<decltype(t)>;
+      if constexpr (std::same_as<T, IniSectionView>)
+	return IniSection(t);
+      else if constexpr (std::same_as<T, IniStringView>)
+	return IniString(t);
+      else if constexpr (std::same_as<T, IniIdentifierView>)
+	return IniIdentifier(t);
+      else if constexpr (std::same_as<T, IniCommentView>)
+	return IniComment(t);
+      else
+	return t;
+    }, token);
+  }
+
+  // Owned tokens are already owned.
+  inline const IniVariant& to_owned(const IniVariant& token) noexcept {
+    return token;
+  }
 
   template<typename T>
   concept TokenTyped = requires(T a) {
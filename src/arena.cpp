@@ -0,0 +1,55 @@
+#include <arena.hpp>
+
+namespace libini {
+
+  thread_local IniArena::Region* IniArena::current_ = nullptr;
+
+  IniArena::Region::Region(IniArena& arena)
+    : arena_(arena),
+      resource_([&arena]() -> std::pmr::monotonic_buffer_resource& {
+	std::lock_guard lock{arena.mutex_};
+	return arena.regions_.emplace_back(&arena.upstream_);
+      }()),
+      previous_(current_) {
+    current_ = this;
+  }
+
+  IniArena::Region::~Region() noexcept {
+    current_ = previous_;
+  }
+
+  std::pmr::monotonic_buffer_resource& IniArena::resource() noexcept {
+    for (auto region = current_; region; region = region->previous_)
+      if (&region->arena_ == this)
+	return region->resource_;
+
+    return main_;
+  }
+
+  std::size_t IniArena::size() const noexcept {
+    return upstream_.size.load(std::memory_order_relaxed);
+  }
+
+  void* IniArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    return resource().allocate(bytes, alignment);
+  }
+
+  bool IniArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+  }
+
+  // Resources only go upstream for a new block, which is rare enough to count every time.
+  void* IniArena::Upstream::do_allocate(std::size_t bytes, std::size_t alignment) {
+    auto pointer = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    size.fetch_add(bytes, std::memory_order_relaxed);
+    return pointer;
+  }
+
+  void IniArena::Upstream::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) noexcept {
+    std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+  }
+
+  bool IniArena::Upstream::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+  }
+};
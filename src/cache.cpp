@@ -0,0 +1,79 @@
+#include <cache.hpp>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace libini {
+
+  namespace {
+
+    // Tells apart temporary files written at the same time by threads of one process.
+    std::atomic<std::uint64_t> temporary_count{0};
+  };
+
+  IniParseCache::IniParseCache(std::filesystem::path directory)
+    : directory_(std::move(directory)) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+
+    if (error || !std::filesystem::is_directory(directory_, error))
+      throw std::runtime_error("libini error: could not create cache directory.");
+  }
+
+  std::optional<IniImage> IniParseCache::load(std::string_view text) const noexcept {
+    try {
+      auto path = entry_path(text);
+
+      std::error_code error;
+      if (!std::filesystem::exists(path, error))
+	return std::nullopt;
+
+      return IniImage{path};
+    } catch (...) {
+      // An entry that can not be read is a miss, it is replaced on the next store.
+      return std::nullopt;
+    }
+  }
+
+  bool IniParseCache::store(std::string_view text, const IniParserResult& result) const noexcept {
+    std::filesystem::path temporary;
+
+    try {
+      auto path = entry_path(text);
+      char suffix[64];
+      std::snprintf(suffix, sizeof(suffix), ".%ld.%llu.tmp", static_cast<long>(::getpid()),
+		    static_cast<unsigned long long>(temporary_count++));
+      temporary = path;
+      temporary += suffix;
+
+      write_image(result, temporary);
+      std::filesystem::rename(temporary, path);
+      return true;
+    } catch (...) {
+      std::error_code error;
+      if (!temporary.empty())
+	std::filesystem::remove(temporary, error);
+
+      return false;
+    }
+  }
+
+  const std::filesystem::path& IniParseCache::directory() const noexcept {
+    return directory_;
+  }
+
+  /*
+   * Path of the entry for the text.
+   */
+  std::filesystem::path IniParseCache::entry_path(std::string_view text) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%llx.img", static_cast<unsigned long long>(hash_content(text)),
+		  static_cast<unsigned long long>(text.size()));
+    return directory_ / name;
+  }
+};
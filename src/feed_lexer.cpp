@@ -0,0 +1,110 @@
+#include <feed_lexer.hpp>
+
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+namespace libini {
+
+  // Resumed by hand, by next(). Keeps its frame around when finished so done() can be asked.
+  struct FeedLexer::Lexing {
+    struct promise_type {
+      Lexing get_return_object() noexcept {
+	return {std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_always final_suspend() noexcept { return {}; }
+      void return_void() noexcept {}
+      void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+  };
+
+  FeedLexer::FeedLexer()
+    : input_{std::make_unique<Input>()}, coroutine_{lex(*input_).handle} {
+  }
+
+  FeedLexer::~FeedLexer() noexcept {
+    if (coroutine_)
+      coroutine_.destroy();
+  }
+
+  FeedLexer::FeedLexer(FeedLexer&& other) noexcept
+    : input_{std::move(other.input_)}, coroutine_{std::exchange(other.coroutine_, nullptr)} {
+  }
+
+  FeedLexer& FeedLexer::operator=(FeedLexer&& other) noexcept {
+    if (this != &other) {
+      if (coroutine_)
+	coroutine_.destroy();
+      input_ = std::move(other.input_);
+      coroutine_ = std::exchange(other.coroutine_, nullptr);
+    }
+
+    return *this;
+  }
+
+  void FeedLexer::feed(std::string_view chunk) {
+    input_->buffer.append(chunk);
+    input_->hungry = false;
+  }
+
+  void FeedLexer::finish() noexcept {
+    input_->finished = true;
+    input_->hungry = false;
+  }
+
+  std::optional<IniVariant> FeedLexer::next() {
+    if (!coroutine_ || coroutine_.done() || input_->hungry)
+      return std::nullopt;
+
+    coroutine_.resume();
+    if (coroutine_.done() || input_->hungry)
+      return std::nullopt;
+
+    return std::exchange(input_->token, std::nullopt);
+  }
+
+  bool FeedLexer::done() const noexcept {
+    return !coroutine_ || coroutine_.done();
+  }
+
+  FeedLexer::Lexing FeedLexer::lex(Input& input) {
+    constexpr std::size_t lookahead = 3;
+    IniTokenStream stream{input.buffer.data(), input.buffer.data() + input.buffer.size()};
+
+    // Feeding may move the buffer, so the stream is pointed at it again after every suspension.
+    auto resume = [&input, &stream](std::size_t offset) {
+      stream.rebase(input.buffer.data() + offset, input.buffer.data() + input.buffer.size());
+    };
+
+    for (;;) {
+      auto start = stream;
+      auto token = stream.next<std::pmr::string>();
+
+      // A token running into the end of the input may go on in the next piece, and so may a number
+      // ending just before it: lexing one looks up to two bytes past its end, as in "1e+5" or "0x1".
+      // Drop what was lexed before it, then lex it again once there is more.
+      if (stream.remaining().size() < lookahead && !input.finished) {
+	input.buffer.erase(0, static_cast<std::size_t>(start.remaining().data() - input.buffer.data()));
+	input.hungry = true;
+	co_await std::suspend_always{};
+
+	stream = start;
+	resume(0);
+	continue;
+      }
+
+      if (!token)
+	co_return;
+
+      auto offset = static_cast<std::size_t>(stream.remaining().data() - input.buffer.data());
+      input.token = std::move(token);
+      co_await std::suspend_always{};
+
+      resume(offset);
+    }
+  }
+};
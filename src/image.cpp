@@ -0,0 +1,618 @@
+#include <image.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace libini {
+
+  namespace {
+
+    constexpr std::array<char, 8> image_magic{'L', 'I', 'B', 'I', 'N', 'I', 'I', 'M'};
+    constexpr std::uint32_t image_version = 3;
+    // Written as is, so an image from a machine with the other byte order reads differently.
+    constexpr std::uint32_t image_byte_order = 0x01020304;
+
+    struct Header {
+      std::array<char, 8> magic;
+      std::uint32_t version;
+      std::uint32_t byte_order;
+      std::uint64_t size;
+      std::uint32_t section_count;
+      std::uint32_t entry_count;
+      std::uint32_t key_buckets;
+      std::uint32_t key_slots;
+      std::uint32_t qualified_buckets;
+      std::uint32_t qualified_slots;
+      std::uint64_t sections;
+      std::uint64_t entries;
+      std::uint64_t key_seeds;
+      std::uint64_t keys;
+      std::uint64_t qualified_seeds;
+      std::uint64_t qualified_keys;
+      std::uint64_t strings;
+      std::uint64_t strings_size;
+    };
+
+    struct Section {
+      std::uint32_t name_offset;
+      std::uint32_t name_length;
+      std::uint32_t first_entry;
+      std::uint32_t entry_count;
+    };
+
+    // The value holds the bits of a number, or the offset (low half) and length (high half) of a string.
+    // The next entries with the same hash of the bare and of the qualified name, plus one, zero ends the chain.
+    struct Entry {
+      std::uint32_t section;
+      std::uint32_t name_offset;
+      std::uint32_t name_length;
+      std::uint32_t type;
+      std::uint64_t value;
+      std::uint32_t next_key;
+      std::uint32_t next_qualified;
+    };
+
+    std::uint64_t qualified_hash(std::string_view section, std::string_view key) noexcept {
+      return hash_name(key, hash_name(".", hash_name(section)));
+    }
+
+    // Seeds of the buckets, and the entry numbers plus one of the chain heads in the slots, zero is empty.
+    struct PerfectHash {
+      std::vector<std::uint32_t> seeds;
+      std::vector<std::uint32_t> slots;
+    };
+
+    // A hash and the first entry that has it.
+    using Named = std::pair<std::uint64_t, std::uint32_t>;
+
+    constexpr std::uint32_t max_seed = 1 << 16;
+
+    /*
+     * The distinct hashes of the entries' names, each with the first entry that has it. Different names
+     * with the same hash, which no seed could tell apart, are chained from it through next in entry order.
+     * Only the first entry with a name is chained, so it wins as in the parse result.
+     */
+    template<typename Hasher, typename Equal>
+    std::vector<Named> distinct(std::size_t count, Hasher hash_of, Equal same, std::vector<std::uint32_t>& next) {
+      std::vector<Named> named(count);
+      for (std::uint32_t i = 0; i < count; i++)
+	named[i] = {hash_of(i), i};
+
+      // Equal hashes are next to each other, in entry order.
+      std::sort(named.begin(), named.end());
+
+      std::vector<Named> first;
+      first.reserve(named.size());
+      next.assign(count, 0);
+      for (std::size_t group = 0, end = 0; group < named.size(); group = end) {
+	first.push_back(named[group]);
+	auto last = named[group].second;
+
+	for (end = group + 1; end < named.size() && named[end].first == named[group].first; end++) {
+	  auto entry = named[end].second;
+	  bool seen = std::any_of(named.begin() + static_cast<std::ptrdiff_t>(group), named.begin() + static_cast<std::ptrdiff_t>(end),
+				  [&same, entry](const Named& earlier) { return same(earlier.second, entry); });
+	  if (!seen) {
+	    next[last] = entry + 1;
+	    last = entry;
+	  }
+	}
+      }
+
+      return first;
+    }
+
+    /*
+     * Finds a seed that puts every name of the bucket in a free slot, and takes the slots.
+     */
+    bool place(PerfectHash& hash, std::size_t bucket, std::span<const Named> named, std::span<const std::uint32_t> members) {
+      for (std::uint32_t seed = 0; seed < max_seed; seed++) {
+	std::size_t placed = 0;
+	for (; placed < members.size(); placed++) {
+	  auto slot = displace_slot(named[members[placed]].first, seed, hash.slots.size());
+	  if (hash.slots[slot] != 0)
+	    break;
+
+	  hash.slots[slot] = named[members[placed]].second + 1;
+	}
+
+	if (placed == members.size()) {
+	  hash.seeds[bucket] = seed;
+	  return true;
+	}
+
+	// Give back the slots taken with this seed.
+	for (std::size_t i = 0; i < placed; i++)
+	  hash.slots[displace_slot(named[members[i]].first, seed, hash.slots.size())] = 0;
+      }
+
+      return false;
+    }
+
+    /*
+     * Builds a perfect hash over the names by hash and displace, as IniPerfectHash does at compile time:
+     * each bucket, fullest first, gets the first seed that puts all of its names in free slots.
+     * Should a bucket find none, it starts over with twice the slots.
+     */
+    PerfectHash perfect_hash(const std::vector<Named>& named) {
+      // About two names per bucket and two slots per name keep the seeds small.
+      auto bucket_count = std::bit_ceil(std::max<std::size_t>(named.size() / 2, 1));
+
+      std::vector<std::uint32_t> first(bucket_count + 1);
+      for (const auto& name : named)
+	first[displace_bucket(name.first, bucket_count) + 1]++;
+
+      // Group the names by bucket, first[b] is where bucket b starts.
+      for (std::size_t b = 0; b < bucket_count; b++)
+	first[b + 1] += first[b];
+
+      std::vector<std::uint32_t> members(named.size());
+      auto next = first;
+      for (std::uint32_t i = 0; i < named.size(); i++)
+	members[next[displace_bucket(named[i].first, bucket_count)]++] = i;
+
+      std::vector<std::uint32_t> order(bucket_count);
+      for (std::uint32_t b = 0; b < bucket_count; b++)
+	order[b] = b;
+      std::stable_sort(order.begin(), order.end(), [&first](std::uint32_t a, std::uint32_t b) {
+	return first[a + 1] - first[a] > first[b + 1] - first[b];
+      });
+
+      auto slot_count = std::bit_ceil(std::max<std::size_t>(named.size() * 2, 1));
+      for (int attempt = 0; attempt < 4; attempt++, slot_count *= 2) {
+	PerfectHash hash{std::vector<std::uint32_t>(bucket_count), std::vector<std::uint32_t>(slot_count)};
+
+	if (std::all_of(order.begin(), order.end(), [&](std::uint32_t bucket) {
+	  return place(hash, bucket, named, std::span<const std::uint32_t>{members}.subspan(first[bucket], first[bucket + 1] - first[bucket]));
+	}))
+	  return hash;
+      }
+
+      throw std::runtime_error("libini error: no perfect hash found.");
+    }
+
+    /*
+     * The first entry the matcher accepts in the chain of the slot the name hashes to. A name not in the table
+     * lands on some slot too, so the matcher must always compare names.
+     */
+    template<typename Next, typename Matcher>
+    std::optional<std::uint32_t> lookup(std::span<const std::uint32_t> seeds, std::span<const std::uint32_t> slots,
+					std::uint64_t hash, Next next, Matcher matches) noexcept {
+      auto slot = slots[displace_slot(hash, seeds[displace_bucket(hash, seeds.size())], slots.size())];
+      for (; slot != 0; slot = next(slot - 1))
+	if (matches(slot - 1))
+	  return slot - 1;
+
+      return std::nullopt;
+    }
+
+    bool is_qualified(std::string_view name, std::string_view section, std::string_view key) noexcept {
+      return name.size() == section.size() + 1 + key.size()
+	&& name.starts_with(section) && name[section.size()] == '.' && name.ends_with(key);
+    }
+
+    std::uint64_t align(std::uint64_t offset) noexcept {
+      return (offset + 7) & ~std::uint64_t{7};
+    }
+
+    // Whether count items of the given size fit in the image at the offset.
+    bool fits(std::uint64_t size, std::uint64_t offset, std::uint64_t count, std::uint64_t item) noexcept {
+      return offset <= size && count <= (size - offset) / item;
+    }
+
+    [[noreturn]] void invalid_image() {
+      throw std::runtime_error("libini error: not a valid image.");
+    }
+  };
+
+  std::vector<std::byte> compile_image(const IniParserResult& result) {
+    std::string strings;
+    std::vector<Section> sections;
+    std::vector<Entry> entries;
+
+    auto intern = [&strings](std::string_view text) {
+      if (strings.size() + text.size() > std::numeric_limits<std::uint32_t>::max())
+	throw std::runtime_error("libini error: result too large for an image.");
+
+      auto offset = static_cast<std::uint32_t>(strings.size());
+      strings.append(text);
+      return std::pair{offset, static_cast<std::uint32_t>(text.size())};
+    };
+
+    for (const auto& node : result) {
+      auto [name_offset, name_length] = intern(node.get_name());
+      sections.push_back({name_offset, name_length, static_cast<std::uint32_t>(entries.size()),
+			  static_cast<std::uint32_t>(node.size())});
+
+      for (const auto& leaf : node) {
+	auto [offset, length] = intern(leaf.get_name());
+	Entry entry{static_cast<std::uint32_t>(sections.size() - 1), offset, length, 0, 0, 0, 0};
+
+	std::visit([&entry, &intern](const auto& token) {
+	  using T = std::decay_t<decltype(token)>;
+	  entry.type = static_cast<std::uint32_t>(T::token_type);
+
+	  if constexpr (std::same_as<T, IniInteger> || std::same_as<T, IniFloat>) {
+	    entry.value = std::bit_cast<std::uint64_t>(token.token_value);
+	  } else if constexpr (T::token_type == TokenType::String) {
+	    auto [text_offset, text_length] = intern(token.token_value);
+	    entry.value = std::uint64_t{text_length} << 32 | text_offset;
+	  } else {
+	    // The parser only produces numbers and strings as values.
+	    throw std::runtime_error("libini error: value can not be stored in an image.");
+	  }
+	}, leaf.get_variant());
+
+	entries.push_back(entry);
+      }
+    }
+
+    if (entries.size() > std::numeric_limits<std::uint32_t>::max() / 2)
+      throw std::runtime_error("libini error: result too large for an image.");
+
+    auto text = [&strings](std::uint32_t offset, std::uint32_t length) {
+      return std::string_view{strings}.substr(offset, length);
+    };
+    auto name = [&entries, &text](std::uint32_t i) {
+      return text(entries[i].name_offset, entries[i].name_length);
+    };
+    auto section = [&entries, &sections, &text](std::uint32_t i) {
+      const auto& s = sections[entries[i].section];
+      return text(s.name_offset, s.name_length);
+    };
+
+    std::vector<std::uint32_t> next_key, next_qualified;
+    auto keys = perfect_hash(distinct(entries.size(), [&name](std::uint32_t i) { return hash_name(name(i)); },
+				      [&name](std::uint32_t i, std::uint32_t j) { return name(i) == name(j); }, next_key));
+
+    auto qualified_keys = perfect_hash(distinct(entries.size(), [&section, &name](std::uint32_t i) {
+      return qualified_hash(section(i), name(i));
+    }, [&section, &name](std::uint32_t i, std::uint32_t j) {
+      return section(i) == section(j) && name(i) == name(j);
+    }, next_qualified));
+
+    for (std::size_t i = 0; i < entries.size(); i++) {
+      entries[i].next_key = next_key[i];
+      entries[i].next_qualified = next_qualified[i];
+    }
+
+    Header header{};
+    header.magic = image_magic;
+    header.version = image_version;
+    header.byte_order = image_byte_order;
+    header.section_count = static_cast<std::uint32_t>(sections.size());
+    header.entry_count = static_cast<std::uint32_t>(entries.size());
+    header.key_buckets = static_cast<std::uint32_t>(keys.seeds.size());
+    header.key_slots = static_cast<std::uint32_t>(keys.slots.size());
+    header.qualified_buckets = static_cast<std::uint32_t>(qualified_keys.seeds.size());
+    header.qualified_slots = static_cast<std::uint32_t>(qualified_keys.slots.size());
+    header.sections = align(sizeof(Header));
+    header.entries = align(header.sections + sections.size() * sizeof(Section));
+    header.key_seeds = align(header.entries + entries.size() * sizeof(Entry));
+    header.keys = align(header.key_seeds + keys.seeds.size() * sizeof(std::uint32_t));
+    header.qualified_seeds = align(header.keys + keys.slots.size() * sizeof(std::uint32_t));
+    header.qualified_keys = align(header.qualified_seeds + qualified_keys.seeds.size() * sizeof(std::uint32_t));
+    header.strings = align(header.qualified_keys + qualified_keys.slots.size() * sizeof(std::uint32_t));
+    header.strings_size = strings.size();
+    header.size = header.strings + strings.size();
+
+    std::vector<std::byte> image(header.size);
+    auto put = [&image](std::uint64_t offset, const void* data, std::size_t size) {
+      if (size > 0)
+	std::memcpy(image.data() + offset, data, size);
+    };
+
+    put(0, &header, sizeof(header));
+    put(header.sections, sections.data(), sections.size() * sizeof(Section));
+    put(header.entries, entries.data(), entries.size() * sizeof(Entry));
+    put(header.key_seeds, keys.seeds.data(), keys.seeds.size() * sizeof(std::uint32_t));
+    put(header.keys, keys.slots.data(), keys.slots.size() * sizeof(std::uint32_t));
+    put(header.qualified_seeds, qualified_keys.seeds.data(), qualified_keys.seeds.size() * sizeof(std::uint32_t));
+    put(header.qualified_keys, qualified_keys.slots.data(), qualified_keys.slots.size() * sizeof(std::uint32_t));
+    put(header.strings, strings.data(), strings.size());
+    return image;
+  }
+
+  void write_image(const IniParserResult& result, const std::filesystem::path& path) {
+    auto image = compile_image(result);
+
+    std::ofstream file{path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+    file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+
+    if (!file.flush())
+      throw std::runtime_error("libini error: could not write image.");
+  }
+
+  IniImageMember::IniImageMember(const IniImage& image, std::uint32_t entry) noexcept
+    : image_(&image), entry_(entry) {
+  }
+
+  namespace {
+
+    const Header& header_of(std::span<const std::byte> bytes) noexcept {
+      return *reinterpret_cast<const Header*>(bytes.data());
+    }
+
+    template<typename T>
+    std::span<const T> table(std::span<const std::byte> bytes, std::uint64_t offset, std::uint32_t count) noexcept {
+      return {reinterpret_cast<const T*>(bytes.data() + offset), count};
+    }
+
+    std::string_view string(std::span<const std::byte> bytes, std::uint32_t offset, std::uint32_t length) noexcept {
+      return {reinterpret_cast<const char*>(bytes.data() + header_of(bytes).strings + offset), length};
+    }
+
+    const Entry& entry_of(std::span<const std::byte> bytes, std::uint32_t entry) noexcept {
+      const auto& header = header_of(bytes);
+      return table<Entry>(bytes, header.entries, header.entry_count)[entry];
+    }
+
+    const Section& section_of(std::span<const std::byte> bytes, std::uint32_t entry) noexcept {
+      const auto& header = header_of(bytes);
+      return table<Section>(bytes, header.sections, header.section_count)[entry_of(bytes, entry).section];
+    }
+
+    std::string_view name_of(std::span<const std::byte> bytes, std::uint32_t entry) noexcept {
+      const auto& e = entry_of(bytes, entry);
+      return string(bytes, e.name_offset, e.name_length);
+    }
+
+    std::string_view section_name_of(std::span<const std::byte> bytes, std::uint32_t entry) noexcept {
+      const auto& s = section_of(bytes, entry);
+      return string(bytes, s.name_offset, s.name_length);
+    }
+  };
+
+  std::string_view IniImageMember::get_name() const noexcept {
+    return name_of(image_->bytes_, entry_);
+  }
+
+  std::string_view IniImageMember::get_section() const noexcept {
+    return section_name_of(image_->bytes_, entry_);
+  }
+
+  TokenType IniImageMember::get_type() const noexcept {
+    return static_cast<TokenType>(entry_of(image_->bytes_, entry_).type);
+  }
+
+  IniVariantView IniImageMember::get_variant() const noexcept {
+    switch (get_type()) {
+    case TokenType::Integer:
+      return IniInteger{integer()};
+    case TokenType::Float:
+      return IniFloat{floating()};
+    default:
+      return IniStringView{text()};
+    }
+  }
+
+  std::int64_t IniImageMember::integer() const noexcept {
+    return std::bit_cast<std::int64_t>(entry_of(image_->bytes_, entry_).value);
+  }
+
+  double IniImageMember::floating() const noexcept {
+    return std::bit_cast<double>(entry_of(image_->bytes_, entry_).value);
+  }
+
+  std::string_view IniImageMember::text() const noexcept {
+    auto value = entry_of(image_->bytes_, entry_).value;
+    return string(image_->bytes_, static_cast<std::uint32_t>(value), static_cast<std::uint32_t>(value >> 32));
+  }
+
+  IniImage::IniImage(const std::filesystem::path& path)
+    : bytes_{}, mapping_(nullptr), mapping_size_(0) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw std::runtime_error("libini error: could not open image.");
+
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+      auto size = static_cast<std::size_t>(info.st_size);
+      void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (address != MAP_FAILED) {
+	mapping_ = address;
+	mapping_size_ = size;
+	bytes_ = {static_cast<const std::byte*>(address), size};
+      }
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+
+    try {
+      validate();
+    } catch (...) {
+      unmap();
+      throw;
+    }
+  }
+
+  IniImage::IniImage(std::span<const std::byte> bytes)
+    : bytes_(bytes), mapping_(nullptr), mapping_size_(0) {
+    validate();
+  }
+
+  IniImage::~IniImage() noexcept {
+    unmap();
+  }
+
+  IniImage::IniImage(IniImage&& other) noexcept
+    : bytes_{std::exchange(other.bytes_, {})},
+      mapping_{std::exchange(other.mapping_, nullptr)},
+      mapping_size_{std::exchange(other.mapping_size_, 0)} {
+  }
+
+  IniImage& IniImage::operator=(IniImage&& other) noexcept {
+    if (this != &other) {
+      unmap();
+      bytes_ = std::exchange(other.bytes_, {});
+      mapping_ = std::exchange(other.mapping_, nullptr);
+      mapping_size_ = std::exchange(other.mapping_size_, 0);
+    }
+
+    return *this;
+  }
+
+  bool IniImage::has_member(std::string_view name) const noexcept {
+    return find(name).has_value();
+  }
+
+  IniImageMember IniImage::operator [](std::string_view name) const {
+    if (auto member = find(name))
+      return *member;
+
+    throw std::runtime_error("libini error: member not found");
+  }
+
+  std::optional<IniImageMember> IniImage::find(std::string_view name) const noexcept {
+    if (bytes_.empty())
+      return std::nullopt;
+
+    const auto& header = header_of(bytes_);
+    auto hash = hash_name(name);
+    auto entry = lookup(table<std::uint32_t>(bytes_, header.key_seeds, header.key_buckets),
+			table<std::uint32_t>(bytes_, header.keys, header.key_slots), hash, [this](std::uint32_t i) {
+      return entry_of(bytes_, i).next_key;
+    }, [this, name](std::uint32_t i) {
+      return name_of(bytes_, i) == name;
+    });
+
+    // The hash of a qualified name is the hash of its text.
+    if (!entry)
+      entry = lookup(table<std::uint32_t>(bytes_, header.qualified_seeds, header.qualified_buckets),
+		     table<std::uint32_t>(bytes_, header.qualified_keys, header.qualified_slots), hash, [this](std::uint32_t i) {
+	return entry_of(bytes_, i).next_qualified;
+      }, [this, name](std::uint32_t i) {
+	return is_qualified(name, section_name_of(bytes_, i), name_of(bytes_, i));
+      });
+
+    if (entry)
+      return IniImageMember{*this, *entry};
+
+    return std::nullopt;
+  }
+
+  std::optional<IniImageMember> IniImage::find(std::string_view section, std::string_view key) const noexcept {
+    if (bytes_.empty())
+      return std::nullopt;
+
+    const auto& header = header_of(bytes_);
+    auto entry = lookup(table<std::uint32_t>(bytes_, header.qualified_seeds, header.qualified_buckets),
+			table<std::uint32_t>(bytes_, header.qualified_keys, header.qualified_slots),
+			qualified_hash(section, key), [this](std::uint32_t i) {
+      return entry_of(bytes_, i).next_qualified;
+    }, [this, section, key](std::uint32_t i) {
+      return section_name_of(bytes_, i) == section && name_of(bytes_, i) == key;
+    });
+
+    if (entry)
+      return IniImageMember{*this, *entry};
+
+    return std::nullopt;
+  }
+
+  std::size_t IniImage::size() const noexcept {
+    return bytes_.empty() ? 0 : header_of(bytes_).section_count;
+  }
+
+  std::string_view IniImage::section_name(std::uint32_t section) const noexcept {
+    const auto& header = header_of(bytes_);
+    const auto& s = table<Section>(bytes_, header.sections, header.section_count)[section];
+    return string(bytes_, s.name_offset, s.name_length);
+  }
+
+  std::pair<std::uint32_t, std::uint32_t> IniImage::section_members(std::uint32_t section) const noexcept {
+    const auto& header = header_of(bytes_);
+    const auto& s = table<Section>(bytes_, header.sections, header.section_count)[section];
+    return {s.first_entry, s.entry_count};
+  }
+
+  /*
+   * Checks that every table and every reference in the image stays within it.
+   */
+  void IniImage::validate() const {
+    auto size = bytes_.size();
+    if (size < sizeof(Header) || reinterpret_cast<std::uintptr_t>(bytes_.data()) % alignof(Header) != 0)
+      invalid_image();
+
+    const auto& header = header_of(bytes_);
+    if (header.magic != image_magic || header.version != image_version
+	|| header.byte_order != image_byte_order || header.size != size)
+      invalid_image();
+
+    if (header.sections % alignof(Section) != 0 || !fits(size, header.sections, header.section_count, sizeof(Section))
+	|| header.entries % alignof(Entry) != 0 || !fits(size, header.entries, header.entry_count, sizeof(Entry))
+	|| header.key_seeds % alignof(std::uint32_t) != 0
+	|| !fits(size, header.key_seeds, header.key_buckets, sizeof(std::uint32_t))
+	|| header.keys % alignof(std::uint32_t) != 0 || !fits(size, header.keys, header.key_slots, sizeof(std::uint32_t))
+	|| header.qualified_seeds % alignof(std::uint32_t) != 0
+	|| !fits(size, header.qualified_seeds, header.qualified_buckets, sizeof(std::uint32_t))
+	|| header.qualified_keys % alignof(std::uint32_t) != 0
+	|| !fits(size, header.qualified_keys, header.qualified_slots, sizeof(std::uint32_t))
+	|| !fits(size, header.strings, header.strings_size, 1))
+      invalid_image();
+
+    auto in_strings = [&header](std::uint64_t offset, std::uint64_t length) {
+      return offset <= header.strings_size && length <= header.strings_size - offset;
+    };
+
+    for (const auto& section : table<Section>(bytes_, header.sections, header.section_count))
+      if (!in_strings(section.name_offset, section.name_length)
+	  || section.first_entry > header.entry_count || section.entry_count > header.entry_count - section.first_entry)
+	invalid_image();
+
+    // Chains only go forward, so following one always ends.
+    auto in_chain = [&header](std::uint32_t entry, std::uint32_t next) {
+      return next == 0 || (next > entry + 1 && next <= header.entry_count);
+    };
+
+    std::uint32_t index = 0;
+    for (const auto& entry : table<Entry>(bytes_, header.entries, header.entry_count)) {
+      if (entry.section >= header.section_count || !in_strings(entry.name_offset, entry.name_length)
+	  || !in_chain(index, entry.next_key) || !in_chain(index, entry.next_qualified))
+	invalid_image();
+      index++;
+
+      auto type = static_cast<TokenType>(entry.type);
+      if (type != TokenType::Integer && type != TokenType::Float
+	  && (type != TokenType::String || !in_strings(entry.value & 0xffffffff, entry.value >> 32)))
+	invalid_image();
+    }
+
+    // Buckets and slots are masked, so their numbers must be powers of two. Any seed is valid.
+    if (!std::has_single_bit(header.key_buckets) || !std::has_single_bit(header.qualified_buckets))
+      invalid_image();
+
+    for (auto slots : {table<std::uint32_t>(bytes_, header.keys, header.key_slots),
+		       table<std::uint32_t>(bytes_, header.qualified_keys, header.qualified_slots)}) {
+      if (!std::has_single_bit(slots.size())
+	  || std::any_of(slots.begin(), slots.end(), [&header](std::uint32_t slot) { return slot > header.entry_count; }))
+	invalid_image();
+    }
+  }
+
+  /*
+   * Releases the current mapping, if any.
+   */
+  void IniImage::unmap() noexcept {
+    if (mapping_ != nullptr) {
+      ::munmap(mapping_, mapping_size_);
+      mapping_ = nullptr;
+      mapping_size_ = 0;
+    }
+  }
+};
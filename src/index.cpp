@@ -0,0 +1,71 @@
+#include <index.hpp>
+
+#include <bit>
+#include <cstring>
+
+namespace libini {
+
+  namespace {
+
+    constexpr std::uint64_t prime1 = 0x9e3779b185ebca87;
+    constexpr std::uint64_t prime2 = 0xc2b2ae3d27d4eb4f;
+    constexpr std::uint64_t prime3 = 0x165667b19e3779f9;
+    constexpr std::uint64_t prime4 = 0x85ebca77c2b2ae63;
+    constexpr std::uint64_t prime5 = 0x27d4eb2f165667c5;
+
+    template<typename T>
+    T read(const char* data) noexcept {
+      T value;
+      std::memcpy(&value, data, sizeof(value));
+      return value;
+    }
+
+    std::uint64_t round(std::uint64_t accumulator, std::uint64_t input) noexcept {
+      return std::rotl(accumulator + input * prime2, 31) * prime1;
+    }
+
+    std::uint64_t merge(std::uint64_t hash, std::uint64_t accumulator) noexcept {
+      return (hash ^ round(0, accumulator)) * prime1 + prime4;
+    }
+  };
+
+  std::uint64_t hash_content(std::string_view text, std::uint64_t seed) noexcept {
+    auto data = text.data();
+    auto end = data + text.size();
+    std::uint64_t hash;
+
+    if (text.size() >= 32) {
+      // Four independent lanes, so the multiplications overlap.
+      std::uint64_t lanes[4]{seed + prime1 + prime2, seed + prime2, seed, seed - prime1};
+
+      for (; end - data >= 32; data += 32)
+	for (int i = 0; i < 4; i++)
+	  lanes[i] = round(lanes[i], read<std::uint64_t>(data + 8 * i));
+
+      hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+      for (auto lane : lanes)
+	hash = merge(hash, lane);
+    } else {
+      hash = seed + prime5;
+    }
+
+    hash += text.size();
+
+    for (; end - data >= 8; data += 8)
+      hash = std::rotl(hash ^ round(0, read<std::uint64_t>(data)), 27) * prime1 + prime4;
+
+    if (end - data >= 4) {
+      hash = std::rotl(hash ^ read<std::uint32_t>(data) * prime1, 23) * prime2 + prime3;
+      data += 4;
+    }
+
+    for (; data < end; data++)
+      hash = std::rotl(hash ^ static_cast<unsigned char>(*data) * prime5, 11) * prime1;
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    return hash ^ (hash >> 32);
+  }
+};
@@ -1,18 +1,118 @@
 #include <lexer.hpp>
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <system_error>
+
 namespace libini {
 
+  namespace {
+
+    /*
+     * Power of ten of a decimal number, counted from its first significant digit.
+     * Only its sign matters: it tells a number too large for a double from one too small.
+     */
+    long decimal_order(const char* first, const char* last) noexcept {
+      long order = 0;
+      bool significant = false;
+      for (; first != last && is_numeric(*first); ++first)
+	if (significant || *first != '0') {
+	  significant = true;
+	  order++;
+	}
+
+      if (first != last && *first == '.')
+	for (++first; first != last && is_numeric(*first); ++first)
+	  if (!significant) {
+	    significant = *first != '0';
+	    order -= !significant;
+	  }
+
+      if (first == last || (*first != 'e' && *first != 'E'))
+	return order;
+
+      ++first;
+      bool negative = first != last && *first == '-';
+      if (first != last && (*first == '-' || *first == '+'))
+	++first;
+
+      // Saturated, an exponent far outside the range of a double only needs to keep its sign.
+      long exponent = 0;
+      for (; first != last && is_numeric(*first); ++first)
+	exponent = std::min(exponent * 10 + (*first - '0'), 1L << 20);
+
+      return negative ? order - exponent : order + exponent;
+    }
+
+    /*
+     * Converts the text of a number lexeme. Integers that do not fit in 64 bits become floats,
+     * rounded to the nearest double. Floats beyond the range of a double become infinity,
+     * and those too close to zero become zero, as with strtod().
+     */
+    std::variant<IniInteger, IniFloat> to_number(const IniLexeme& lexeme) noexcept {
+      auto first = lexeme.text.data();
+      auto last = first + lexeme.text.size();
+
+      bool negative = *first == '-';
+      if (*first == '-' || *first == '+')
+	++first;
+
+      bool hexadecimal = last - first > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X');
+      if (hexadecimal)
+	first += 2;
+
+      if (lexeme.type == TokenType::Integer) {
+	constexpr auto max = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+	std::uint64_t magnitude = 0;
+	auto [end, error] = std::from_chars(first, last, magnitude, hexadecimal ? 16 : 10);
+
+	if (error == std::errc() && magnitude <= max + negative)
+	  return IniInteger(static_cast<std::int64_t>(negative ? 0 - magnitude : magnitude));
+      }
+
+      double value = 0;
+      auto [end, error] = std::from_chars(first, last, value, hexadecimal ? std::chars_format::hex : std::chars_format::general);
+
+      // Hexadecimal lexemes are integers, so out of range can only mean too large.
+      if (error == std::errc::result_out_of_range)
+	value = hexadecimal || decimal_order(first, last) > 0 ? std::numeric_limits<double>::infinity() : 0.0;
+
+      return IniFloat(negative ? -value : value);
+    }
+  };
+
   IniLexer::IniLexer(const std::string file_name) noexcept
     : stream_{}, file_name_(file_name) {
   }
 
+  IniLexer::IniLexer(const char* file_name) noexcept
+    : IniLexer(std::string(file_name)) {
+  }
+
+  IniLexer::IniLexer(std::string_view text) noexcept
+    : stream_{}, file_name_{}, borrowed_{text} {
+  }
+
+  IniLexer::IniLexer(std::span<const std::byte> bytes) noexcept
+    : IniLexer(std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size())) {
+  }
+
+  IniLexer::IniLexer(std::istream& input)
+    : stream_{}, file_name_{}, buffer_(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()) {
+  }
+
   IniLexer::~IniLexer() noexcept {
     if (stream_.is_open())
       stream_.close();
   }
 
   IniLexer::IniLexer(IniLexer&& other) noexcept
-    : stream_{std::move(other.stream_)}, file_name_{std::move(other.file_name_)} {
+    : stream_{std::move(other.stream_)}, file_name_{std::move(other.file_name_)},
+      buffer_{std::move(other.buffer_)}, borrowed_{other.borrowed_} {
   }
 
   IniLexer& IniLexer::operator=(IniLexer&& other) noexcept {
@@ -20,6 +120,8 @@ namespace libini {
       if (stream_.is_open())
 	stream_.close();
       std::swap(other.stream_, stream_);
+      std::swap(other.buffer_, buffer_);
+      std::swap(other.borrowed_, borrowed_);
     }
 
     return *this;
@@ -33,195 +135,370 @@ namespace libini {
   // Tokenizes (reads and converts content to token representations) the .ini file pointed to by the fstream. 
   IniTokens IniLexer::tokenize(std::pmr::polymorphic_allocator<IniVariant> allocator) {
     IniTokens tokens{allocator};
-    read_all(tokens);
+    auto text = load();
+    read_buffer(text.data(), text.data() + text.size(), tokens);
+    return tokens;
+  }
+
+  // Same as tokenize(), but the tokens borrow from the lexer's buffer.
+  IniTokenViews IniLexer::tokenize_view(std::pmr::polymorphic_allocator<IniVariantView> allocator) {
+    IniTokenViews tokens{allocator};
+    auto text = load();
+    read_buffer(text.data(), text.data() + text.size(), tokens);
     return tokens;
   }
 
   /*
-   * Read and tokenize an entire .ini file.
+   * Read an entire .ini file into the buffer with a single bulk read.
+   * Throws if the file can not be opened or read.
    */
-  void IniLexer::read_all(IniTokens& tokens) noexcept {
+  void IniLexer::read_all() {
     if (!stream_.is_open())
-      stream_.open(file_name_, std::fstream::ios_base::in);
-
-    // Tell the ifstream to not skip whitespace, EOL, etc.
-    stream_ >> std::noskipws;
-
-    IniIterator eos;
-    IniIterator fiter(stream_);
-    auto none = TokenType::Null;
-    auto eof = TokenType::EndOfFile;
-    Predicate delimiter = [](char){return false;};
-
-    for(auto token = none; token != eof; token = next_token(fiter, eos, token, delimiter)) {
-      // TODO: The rest of the lexer logic...
-      switch (token) {
-      case TokenType::LBrace:
-	fiter++;
-	tokens.push_back(IniLBrace());
-	break;
-      case TokenType::Section:
-	tokens.push_back(IniSection(read_name(fiter, eos, delimiter)));
-	break;
-      case TokenType::RBrace:
-	fiter++;
-	tokens.push_back(IniRBrace());
-	break;
-      case TokenType::SingleQuote:
-	fiter++;
-	tokens.push_back(IniSingleQuote());
-	break;
-      case TokenType::DoubleQuote:
-	fiter++;
-	tokens.push_back(IniDoubleQuote());
-	break;
-      case TokenType::String:
-	tokens.push_back(IniString(read_name(fiter, eos, delimiter)));
-	break;
-      case TokenType::Equals:
-	fiter++;
-	tokens.push_back(IniEquals());
-	break;
-      case TokenType::Identifier:
-	tokens.push_back(IniIdentifier(read_name(fiter, eos, delimiter)));
-	break;
-      case TokenType::Number:
-	tokens.push_back(IniNumber(std::stof(read_number(fiter, eos))));
-	break;
-      default:
-	break;
-      }
+      stream_.open(file_name_, std::fstream::ios_base::in | std::fstream::ios_base::binary);
+
+    buffer_.clear();
+    // A directory opens fine, but has no size to read.
+    std::error_code error;
+    if (!stream_.is_open() || std::filesystem::is_directory(file_name_, error))
+      throw std::runtime_error("libini error: could not open file.");
+
+    bool failed = true;
+    if (stream_.seekg(0, std::ios_base::end)) {
+      auto size = std::max<std::streamoff>(stream_.tellg(), 0);
+      stream_.seekg(0, std::ios_base::beg);
+      buffer_.resize(static_cast<std::size_t>(size));
+      stream_.read(buffer_.data(), static_cast<std::streamsize>(size));
+      buffer_.resize(static_cast<std::size_t>(stream_.gcount()));
+      // A file that shrank while being read is short, not failed.
+      failed = stream_.bad();
     }
 
     // We're done with the stream, so close it to prevent leaks
     // and make it reusable.
     stream_.close();
+
+    if (failed)
+      throw std::runtime_error("libini error: could not read file.");
+  }
+
+  // Same as tokenize_view(), but the tokens are packed into 8 bytes each.
+  std::optional<IniCompactTokens> IniLexer::tokenize_compact(std::pmr::polymorphic_allocator<IniCompactToken> allocator) {
+    IniCompactTokens tokens{{}, std::pmr::vector<IniCompactToken>{allocator}};
+    auto text = load();
+    if (!read_compact(text.data(), text.data() + text.size(), tokens))
+      return std::nullopt;
+    return tokens;
   }
 
   /*
-   * Peeks in the file stream and determines what the next target is.
+   * The text to lex. Reads the file first, if the lexer has one.
    */
-  TokenType IniLexer::next_token(IniIterator& fiter,
-				 IniIterator& eos,
-				 const TokenType previous,
-				 Predicate& delimiter) noexcept {
-    if (fiter == eos)
-      return TokenType::EndOfFile;
-
-    char next = *fiter;
-
-    if (is_whitespace_or_eol(next)) {
-      // Discard the whitespace and continue.
-      fiter++;
-      return next_token(fiter, eos, previous, delimiter);
+  std::string_view IniLexer::load() {
+    if (borrowed_)
+      return *borrowed_;
+
+    if (!file_name_.empty())
+      read_all();
+
+    return buffer_;
+  }
+
+  // Reads the file and hands out the state machine over it.
+  IniTokenStream IniLexer::stream() {
+    auto text = load();
+    return IniTokenStream(text.data(), text.data() + text.size());
+  }
+
+  /*
+   * Read and tokenize an entire in-memory buffer.
+   * Instantiated for both owned (IniTokens) and borrowed (IniTokenViews) tokens.
+   */
+  template<typename StringType>
+  void IniLexerBase::read_buffer(IniIterator fiter, IniIterator eos, BasicIniTokens<StringType>& tokens) noexcept {
+    IniTokenStream stream{fiter, eos};
+
+    while (auto token = stream.next<StringType>())
+      tokens.push_back(std::move(*token));
+  }
+
+  template void IniLexerBase::read_buffer<std::pmr::string>(IniIterator, IniIterator, IniTokens&) noexcept;
+  template void IniLexerBase::read_buffer<std::string_view>(IniIterator, IniIterator, IniTokenViews&) noexcept;
+
+  IniTokenStream::IniTokenStream(IniIterator first, IniIterator last) noexcept
+    : fiter_(first), eos_(last), previous_(TokenType::Null), delimiter_(&is_nothing), keep_comments_(false) {
+  }
+
+  // Whether comments are handed out as tokens instead of being skipped.
+  void IniTokenStream::keep_comments(bool keep) noexcept {
+    keep_comments_ = keep;
+  }
+
+  std::string_view IniTokenStream::remaining() const noexcept {
+    return {fiter_, eos_};
+  }
+
+  void IniTokenStream::rebase(IniIterator first, IniIterator last) noexcept {
+    fiter_ = first;
+    eos_ = last;
+  }
+
+  /*
+   * Lexes and returns the next token, or nothing at the end of the buffer.
+   * Instantiated for both owned (std::pmr::string) and borrowed (std::string_view) tokens.
+   */
+  template<typename StringType>
+  std::optional<BasicIniVariant<StringType>> IniTokenStream::next() noexcept {
+    return make_token<StringType>(next_lexeme());
+  }
+
+  template std::optional<IniVariant> IniTokenStream::next<std::pmr::string>() noexcept;
+  template std::optional<IniVariantView> IniTokenStream::next<std::string_view>() noexcept;
+
+  // Lexes the next token, without turning its text into a value.
+  IniLexeme IniTokenStream::next_lexeme() noexcept {
+    auto token = next_token();
+
+    // Comments can appear anywhere, so they must not disturb the state machine.
+    if (token == TokenType::Comment)
+      return {token, skip_comment()};
+
+    previous_ = token;
+
+    switch (previous_) {
+    case TokenType::LBrace:
+    case TokenType::RBrace:
+    case TokenType::SingleQuote:
+    case TokenType::DoubleQuote:
+    case TokenType::Equals:
+      return {previous_, {fiter_++, 1}};
+    case TokenType::Section:
+    case TokenType::String:
+    case TokenType::Identifier:
+      return {previous_, read_name(*delimiter_)};
+    case TokenType::Number:
+      return read_number();
+    default:
+      return {TokenType::EndOfFile, {}};
     }
+  }
 
-    if (is_comment(next)) {
-      // Skip the comment and continue.
-      skip_comment(fiter, eos);
-      return next_token(fiter, eos, previous, delimiter);
+  /*
+   * Turns a lexeme into a token, or nothing for the end of the buffer.
+   * Instantiated for both owned (std::pmr::string) and borrowed (std::string_view) tokens.
+   */
+  template<typename StringType>
+  std::optional<BasicIniVariant<StringType>> make_token(const IniLexeme& lexeme) noexcept {
+    switch (lexeme.type) {
+    case TokenType::LBrace:
+      return IniLBrace();
+    case TokenType::RBrace:
+      return IniRBrace();
+    case TokenType::SingleQuote:
+      return IniSingleQuote();
+    case TokenType::DoubleQuote:
+      return IniDoubleQuote();
+    case TokenType::Equals:
+      return IniEquals();
+    case TokenType::Section:
+      return BasicIniSection<StringType>(StringType(lexeme.text));
+    case TokenType::String:
+      return BasicIniString<StringType>(StringType(lexeme.text));
+    case TokenType::Identifier:
+      return BasicIniIdentifier<StringType>(StringType(lexeme.text));
+    case TokenType::Comment:
+      return BasicIniComment<StringType>(StringType(lexeme.text));
+    case TokenType::Integer:
+    case TokenType::Float:
+      return std::visit([](auto number) -> BasicIniVariant<StringType> { return number; }, to_number(lexeme));
+    default:
+      return std::nullopt;
     }
+  }
 
-    switch (previous) {
+  template std::optional<IniVariant> make_token<std::pmr::string>(const IniLexeme&) noexcept;
+  template std::optional<IniVariantView> make_token<std::string_view>(const IniLexeme&) noexcept;
+
+  /*
+   * Peeks in the buffer and determines what the next target is.
+   */
+  TokenType IniTokenStream::next_token() noexcept {
+    for (;;) {
+      if (fiter_ == eos_)
+	return TokenType::EndOfFile;
+
+      if (is_whitespace_or_eol(*fiter_)) {
+	// Discard the whitespace and continue.
+	fiter_ = is_whitespace_or_eol.find_not(fiter_, eos_);
+      } else if (is_comment(*fiter_)) {
+	if (keep_comments_)
+	  return TokenType::Comment;
+	// Skip the comment and continue.
+	skip_comment();
+      } else
+	break;
+    }
+
+    char next = *fiter_;
+
+    switch (previous_) {
     case TokenType::LBrace:
       // Previous token == [, look for a section.
-      delimiter = make_predicate(']');
+      delimiter_ = &is_rbrace;
       return TokenType::Section;
     case TokenType::Section:
       // Previous token was a section, look for a ].
-      delimiter = is_whitespace;
+      delimiter_ = &is_whitespace;
       return TokenType::RBrace;
     case TokenType::DoubleQuote:
       // Previous token and delimiter == "
       // then look for an identifier
       // otherwise look for a string.
-      if (!delimiter('"')) {
-	delimiter = make_predicate('"');
+      if (!delimiter_->contains('"')) {
+	delimiter_ = &is_double_quote;
 	return TokenType::String;
+      } else if (next == '[') {
+	return TokenType::LBrace;
       } else {
-	delimiter = is_whitespace;
+	delimiter_ = &is_whitespace_or_eol;
 	return TokenType::Identifier;
       }
     case TokenType::SingleQuote:
       // Previous token and delimiter == '
       // then look for an identifier
       // otherwise look for a string.
-      if (!delimiter('\'')) {
-	delimiter = make_predicate('\'');
+      if (!delimiter_->contains('\'')) {
+	delimiter_ = &is_single_quote;
 	return TokenType::String;
       } else if (next == '[') {
 	return TokenType::LBrace;
       } else {
-	delimiter = is_whitespace;
+	delimiter_ = &is_whitespace_or_eol;
 	return TokenType::Identifier;
       }
     case TokenType::String:
       // Previous token was a string, look for either ' or ".
-      if (delimiter('"'))
+      if (delimiter_->contains('"'))
 	return TokenType::DoubleQuote;
       else
 	return TokenType::SingleQuote;
     case TokenType::Identifier:
       // Previous token was an identifier, look for a =.
-      return TokenType::Equals;
+      // Anything else means the identifier was a bare value, so start over.
+      if (next == '=')
+	return TokenType::Equals;
+      else if (next == '[')
+	return TokenType::LBrace;
+      delimiter_ = &is_whitespace_or_eol;
+      return TokenType::Identifier;
     case TokenType::Equals:
       // Previous token was =, look for either a number, a string or a bool.
-      if (is_numeric(next)) {
+      if (is_numeric(next) || ((next == '-' || next == '+') && eos_ - fiter_ > 1 && is_numeric(fiter_[1]))) {
 	return TokenType::Number;
       } else if (next == '\'') {
 	return TokenType::SingleQuote;
       } else if (next == '"') {
 	return TokenType::DoubleQuote;
       } else {
-	delimiter = is_eol;
+	delimiter_ = &is_eol;
 	return TokenType::Identifier;
       }
     case TokenType::Null:
       return TokenType::LBrace;
     default:
-      // You are probably just looking for an identifier.
+      // You are probably just looking for an identifier, which ends with the line if not before.
       if (next == '[')
 	return TokenType::LBrace;
+      delimiter_ = &is_whitespace_or_eol;
       return TokenType::Identifier;
     }
   }
 
   /*
-   * Skips a single-line comment.
+   * Skips a single-line comment, returning its text without the leading #.
    */
-  void IniLexer::skip_comment(IniIterator& fiter, IniIterator& eos) noexcept {
-    for (char symbol = *fiter; fiter != eos; symbol = *(++fiter))
-      if (is_eol(symbol))
-	break;
+  std::string_view IniTokenStream::skip_comment() noexcept {
+    ++fiter_;
+    return read_name(is_eol);
   }
 
   /*
-   * Reads a 'name' given a predicate to determine whether or not to stop.
+   * Reads a 'name' given a set of delimiters to determine where to stop.
    * This is used for sections, identifiers, strings, numbers etc.
+   * The result borrows from the buffer.
    */
-  std::string IniLexer::read_name(IniIterator& fiter,
-				  IniIterator& eos,
-				  Predicate delimiter,
-				  Predicate is_ignorable) noexcept {
-    std::string name = "";
+  std::string_view IniTokenStream::read_name(const IniCharSet& delimiter) noexcept {
+    IniIterator start = fiter_;
+    fiter_ = delimiter.find(fiter_, eos_);
 
-    for (char symbol = *fiter; fiter != eos && !delimiter(symbol); symbol = *(++fiter))
-      if (!is_ignorable(symbol))
-	name += symbol;
+    return {start, static_cast<std::size_t>(fiter_ - start)};
+  }
 
-    return name;
+  /*
+   * Reads a number with an optional sign: a decimal or 0x-prefixed hexadecimal integer,
+   * or a decimal with a fraction and/or an exponent.
+   */
+  IniLexeme IniTokenStream::read_number() noexcept {
+    // Digit runs are short, so a plain loop beats a bulk scan here.
+    auto skip_digits = [this](const IniCharClass& digits) {
+      while (fiter_ != eos_ && digits(*fiter_))
+	++fiter_;
+    };
+
+    IniIterator start = fiter_;
+    if (*fiter_ == '-' || *fiter_ == '+')
+      ++fiter_;
+
+    auto type = TokenType::Integer;
+
+    if (eos_ - fiter_ > 2 && fiter_[0] == '0' && (fiter_[1] == 'x' || fiter_[1] == 'X') && is_hex_digit(fiter_[2])) {
+      fiter_ += 2;
+      skip_digits(is_hex_digit);
+    } else {
+      skip_digits(is_numeric);
+
+      if (fiter_ != eos_ && *fiter_ == '.') {
+	type = TokenType::Float;
+	++fiter_;
+	skip_digits(is_numeric);
+      }
+
+      // Only an exponent if digits follow, otherwise the 'e' is left alone.
+      if (fiter_ != eos_ && (*fiter_ == 'e' || *fiter_ == 'E')) {
+	auto exponent = fiter_ + 1;
+	if (exponent != eos_ && (*exponent == '+' || *exponent == '-'))
+	  ++exponent;
+
+	if (exponent != eos_ && is_numeric(*exponent)) {
+	  type = TokenType::Float;
+	  fiter_ = exponent;
+	  skip_digits(is_numeric);
+	}
+      }
+    }
+
+    return {type, {start, static_cast<std::size_t>(fiter_ - start)}};
   }
 
-  std::string IniLexer::read_number(IniIterator& fiter, IniIterator& eos) noexcept {
-    auto delimiter = compose(is_eol, compose(is_whitespace, [](char c){ return !is_numeric(c); }));
-    std::string integer_part = read_name(fiter, eos, delimiter);
+  /*
+   * Read an entire in-memory buffer into compact tokens.
+   * Fails if the buffer or one of its tokens is too large to be described by one.
+   */
+  bool IniLexerBase::read_compact(IniIterator fiter, IniIterator eos, IniCompactTokens& tokens) noexcept {
+    if (static_cast<std::size_t>(eos - fiter) > IniCompactToken::max_offset)
+      return false;
 
-    if (*fiter == '.') {
-      ++fiter;
-      std::string float_part = read_name(fiter, eos, delimiter);
-      return integer_part + "." + float_part; 
+    tokens.text = {fiter, static_cast<std::size_t>(eos - fiter)};
+    IniTokenStream stream{fiter, eos};
+
+    for (auto lexeme = stream.next_lexeme(); lexeme.type != TokenType::EndOfFile; lexeme = stream.next_lexeme()) {
+      if (lexeme.text.size() > IniCompactToken::max_length)
+	return false;
+
+      tokens.tokens.emplace_back(lexeme.type,
+				 static_cast<std::uint32_t>(lexeme.text.data() - fiter),
+				 static_cast<std::uint32_t>(lexeme.text.size()));
     }
-    
-    return integer_part;
+
+    return true;
   }
 };
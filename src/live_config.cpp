@@ -0,0 +1,143 @@
+#include <live_config.hpp>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+namespace libini {
+
+  namespace {
+
+    // Written in place and closed, or renamed over, as editors and deployment tools do.
+    constexpr std::uint32_t watched_events = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+    /*
+     * Reads the file into a buffer of its own before parsing. A mapping would not do: a writer truncating
+     * the file in place would make reading the pages past the new end fault with SIGBUS.
+     * A missing file throws from the lexer, so it never replaces a good snapshot.
+     */
+    LiveConfig::Snapshot parse_file(const std::filesystem::path& path) {
+      return std::make_shared<const IniParserResult>(IniParser<IniLexer>{path.string()}.parse());
+    }
+  };
+
+  LiveConfig::LiveConfig(std::filesystem::path path, std::chrono::milliseconds settle)
+    : path_(std::move(path)), settle_(settle), snapshot_(), generation_(0), error_(),
+      inotify_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)), wakeup_(::eventfd(0, EFD_CLOEXEC)) {
+    // Watch the directory, so the file is still followed after it is replaced.
+    auto directory = path_.parent_path();
+    if (directory.empty())
+      directory = ".";
+
+    try {
+      if (inotify_ < 0 || wakeup_ < 0 || ::inotify_add_watch(inotify_, directory.c_str(), watched_events) < 0)
+	throw std::runtime_error("libini error: could not watch file.");
+
+      // Watching starts first, so a change during the first parse is not missed.
+      snapshot_.store(parse_file(path_));
+      generation_ = 1;
+      watcher_ = std::thread{[this] { watch(); }};
+    } catch (...) {
+      if (inotify_ >= 0)
+	::close(inotify_);
+      if (wakeup_ >= 0)
+	::close(wakeup_);
+      throw;
+    }
+  }
+
+  LiveConfig::~LiveConfig() noexcept {
+    std::uint64_t one = 1;
+    while (::write(wakeup_, &one, sizeof(one)) < 0 && errno == EINTR) {}
+
+    watcher_.join();
+    ::close(inotify_);
+    ::close(wakeup_);
+  }
+
+  LiveConfig::Snapshot LiveConfig::snapshot() const noexcept {
+    return snapshot_.load(std::memory_order_acquire);
+  }
+
+  std::uint64_t LiveConfig::generation() const noexcept {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+  bool LiveConfig::reload() noexcept {
+    std::lock_guard lock{reload_mutex_};
+
+    try {
+      // Parsed before publishing, readers keep the previous snapshot until then.
+      snapshot_.store(parse_file(path_), std::memory_order_release);
+      generation_.fetch_add(1, std::memory_order_release);
+      error_.clear();
+      return true;
+    } catch (const std::exception& e) {
+      error_ = e.what();
+    } catch (...) {
+      error_ = "libini error: reload failed.";
+    }
+
+    return false;
+  }
+
+  std::string LiveConfig::last_error() const {
+    std::lock_guard lock{reload_mutex_};
+    return error_;
+  }
+
+  const std::filesystem::path& LiveConfig::path() const noexcept {
+    return path_;
+  }
+
+  /*
+   * Waits for changes to the file and reloads it, until woken up by the destructor.
+   */
+  void LiveConfig::watch() noexcept {
+    auto name = path_.filename().string();
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+
+    for (;;) {
+      // Once the file has changed, wait for it to settle rather than for the next event.
+      pollfd descriptors[2]{{inotify_, POLLIN, 0}, {wakeup_, POLLIN, 0}};
+      int ready = ::poll(descriptors, 2, changed ? static_cast<int>(settle_.count()) : -1);
+      if (ready < 0) {
+	if (errno == EINTR)
+	  continue;
+	return;
+      }
+
+      if (descriptors[1].revents != 0)
+	return;
+
+      if (ready == 0) {
+	changed = false;
+	reload();
+	continue;
+      }
+
+      ssize_t length;
+      while ((length = ::read(inotify_, buffer, sizeof(buffer))) > 0) {
+	for (auto event = buffer; event < buffer + length;) {
+	  const auto& header = *reinterpret_cast<const inotify_event*>(event);
+
+	  // Events were dropped, one of them may have been for the file.
+	  if (header.mask & IN_Q_OVERFLOW)
+	    changed = true;
+	  else if (header.len > 0 && name == header.name)
+	    changed = true;
+
+	  event += sizeof(inotify_event) + header.len;
+	}
+      }
+    }
+  }
+};
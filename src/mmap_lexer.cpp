@@ -0,0 +1,150 @@
+#include <mmap_lexer.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <utility>
+
+namespace libini {
+
+  MmapLexer::MmapLexer(const std::string file_name) noexcept
+    : file_name_(file_name), buffer_{}, mapping_(nullptr), mapping_size_(0) {
+  }
+
+  MmapLexer::MmapLexer(const char* file_name) noexcept
+    : MmapLexer(std::string(file_name)) {
+  }
+
+  MmapLexer::MmapLexer(std::span<const char> buffer) noexcept
+    : file_name_{}, buffer_(buffer), mapping_(nullptr), mapping_size_(0) {
+  }
+
+  MmapLexer::MmapLexer(std::string_view buffer) noexcept
+    : MmapLexer(std::span<const char>(buffer)) {
+  }
+
+  MmapLexer::MmapLexer(std::span<const std::byte> buffer) noexcept
+    : MmapLexer(std::span<const char>(reinterpret_cast<const char*>(buffer.data()), buffer.size())) {
+  }
+
+  MmapLexer::~MmapLexer() noexcept {
+    unmap();
+  }
+
+  MmapLexer::MmapLexer(MmapLexer&& other) noexcept
+    : file_name_{std::move(other.file_name_)},
+      buffer_{std::exchange(other.buffer_, {})},
+      mapping_{std::exchange(other.mapping_, nullptr)},
+      mapping_size_{std::exchange(other.mapping_size_, 0)} {
+  }
+
+  MmapLexer& MmapLexer::operator=(MmapLexer&& other) noexcept {
+    if (this != &other) {
+      unmap();
+      file_name_ = std::move(other.file_name_);
+      buffer_ = std::exchange(other.buffer_, {});
+      mapping_ = std::exchange(other.mapping_, nullptr);
+      mapping_size_ = std::exchange(other.mapping_size_, 0);
+    }
+
+    return *this;
+  }
+
+  // Dispatch to tokenize().
+  IniTokens MmapLexer::operator ()(std::pmr::polymorphic_allocator<IniVariant> allocator) {
+    return tokenize(allocator);
+  }
+
+  // Tokenizes (reads and converts content to token representations) the mapped file or borrowed buffer.
+  IniTokens MmapLexer::tokenize(std::pmr::polymorphic_allocator<IniVariant> allocator) {
+    IniTokens tokens{allocator};
+
+    // Remap on every call so changes to the file are picked up.
+    if (!file_name_.empty())
+      map();
+
+    read_buffer(buffer_.data(), buffer_.data() + buffer_.size(), tokens);
+    return tokens;
+  }
+
+  // Same as tokenize(), but the tokens borrow from the mapping or buffer.
+  IniTokenViews MmapLexer::tokenize_view(std::pmr::polymorphic_allocator<IniVariantView> allocator) {
+    IniTokenViews tokens{allocator};
+
+    if (!file_name_.empty())
+      map();
+
+    read_buffer(buffer_.data(), buffer_.data() + buffer_.size(), tokens);
+    return tokens;
+  }
+
+  // Same as tokenize_view(), but the tokens are packed into 8 bytes each.
+  std::optional<IniCompactTokens> MmapLexer::tokenize_compact(std::pmr::polymorphic_allocator<IniCompactToken> allocator) {
+    IniCompactTokens tokens{{}, std::pmr::vector<IniCompactToken>{allocator}};
+
+    if (!file_name_.empty())
+      map();
+
+    if (!read_compact(buffer_.data(), buffer_.data() + buffer_.size(), tokens))
+      return std::nullopt;
+    return tokens;
+  }
+
+  // Maps the file and hands out the state machine over it.
+  IniTokenStream MmapLexer::stream() {
+    if (!file_name_.empty())
+      map();
+
+    return IniTokenStream(buffer_.data(), buffer_.data() + buffer_.size());
+  }
+
+  /*
+   * Maps the file into memory and points the buffer at it.
+   * An empty file results in an empty buffer. Throws if the file can not be opened or mapped.
+   */
+  void MmapLexer::map() {
+    unmap();
+    buffer_ = {};
+
+    int fd = ::open(file_name_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw std::runtime_error("libini error: could not open file.");
+
+    struct stat info;
+    bool failed = ::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode);
+    if (!failed && info.st_size > 0) {
+      auto size = static_cast<std::size_t>(info.st_size);
+      void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (address != MAP_FAILED) {
+	// The lexer walks the file front to back exactly once.
+	::madvise(address, size, MADV_SEQUENTIAL);
+	mapping_ = address;
+	mapping_size_ = size;
+	buffer_ = {static_cast<const char*>(address), size};
+      } else {
+	failed = true;
+      }
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+
+    if (failed)
+      throw std::runtime_error("libini error: could not read file.");
+  }
+
+  /*
+   * Releases the current mapping, if any.
+   */
+  void MmapLexer::unmap() noexcept {
+    if (mapping_ != nullptr) {
+      ::munmap(mapping_, mapping_size_);
+      mapping_ = nullptr;
+      mapping_size_ = 0;
+    }
+  }
+};
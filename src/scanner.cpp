@@ -0,0 +1,103 @@
+#include <scanner.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LIBINI_X86 1
+#include <immintrin.h>
+#endif
+
+namespace libini {
+
+  namespace {
+
+    using FindFunction = const char* (*)(const IniCharSet&, const char*, const char*, bool) noexcept;
+
+    // Portable fallback, also used for the tail of the vectorized scans.
+    const char* find_scalar(const IniCharSet& set,
+			    const char* first, const char* last, bool negate) noexcept {
+      for (; first != last; ++first)
+	if (set.contains(*first) != negate)
+	  break;
+      return first;
+    }
+
+#ifdef LIBINI_X86
+    __attribute__((target("sse2")))
+    const char* find_sse2(const IniCharSet& set,
+			  const char* first, const char* last, bool negate) noexcept {
+      auto members = set.members();
+      while (last - first >= 16) {
+	__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+	__m128i hits = _mm_setzero_si128();
+
+	for (char member : members)
+	  hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(member)));
+
+	auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+	if (negate)
+	  mask = ~mask & 0xFFFFu;
+	if (mask != 0)
+	  return first + __builtin_ctz(mask);
+
+	first += 16;
+      }
+
+      return find_scalar(set, first, last, negate);
+    }
+
+    __attribute__((target("avx2")))
+    const char* find_avx2(const IniCharSet& set,
+			  const char* first, const char* last, bool negate) noexcept {
+      auto members = set.members();
+      while (last - first >= 32) {
+	__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+	__m256i hits = _mm256_setzero_si256();
+
+	for (char member : members)
+	  hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(member)));
+
+	auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+	if (negate)
+	  mask = ~mask;
+	if (mask != 0)
+	  return first + __builtin_ctz(mask);
+
+	first += 32;
+      }
+
+      return find_sse2(set, first, last, negate);
+    }
+#endif
+
+    // Picks the widest implementation the CPU supports, once.
+    FindFunction select_find() noexcept {
+#ifdef LIBINI_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2"))
+	return find_avx2;
+      if (__builtin_cpu_supports("sse2"))
+	return find_sse2;
+#endif
+      return find_scalar;
+    }
+
+    const char* scan(const IniCharSet& set,
+		     const char* first, const char* last, bool negate) noexcept {
+      // Short runs (single spaces, one-letter names) are common, so settle them before dispatching.
+      if (first == last || set.contains(*first) != negate)
+	return first;
+
+      static const FindFunction implementation = select_find();
+      return implementation(set, first + 1, last, negate);
+    }
+  };
+
+  // Returns the first character in [first, last) that is in the set, or last.
+  const char* IniCharSet::find(const char* first, const char* last) const noexcept {
+    return scan(*this, first, last, false);
+  }
+
+  // Returns the first character in [first, last) that is not in the set, or last.
+  const char* IniCharSet::find_not(const char* first, const char* last) const noexcept {
+    return scan(*this, first, last, true);
+  }
+};
@@ -0,0 +1,74 @@
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace libini {
+
+  IniThreadPool::IniThreadPool(std::size_t threads)
+    : active_(0), stopping_(false) {
+    threads = std::max<std::size_t>(threads, 1);
+    workers_.reserve(threads);
+
+    for (std::size_t i = 0; i < threads; i++)
+      workers_.emplace_back([this] { work(); });
+  }
+
+  IniThreadPool::~IniThreadPool() noexcept {
+    {
+      std::lock_guard lock{mutex_};
+      stopping_ = true;
+    }
+    ready_.notify_all();
+
+    for (auto& worker : workers_)
+      worker.join();
+  }
+
+  void IniThreadPool::post(std::function<void()> task) {
+    {
+      std::lock_guard lock{mutex_};
+      tasks_.push_back(std::move(task));
+    }
+    ready_.notify_one();
+  }
+
+  void IniThreadPool::wait() {
+    std::unique_lock lock{mutex_};
+    idle_.wait(lock, [this] { return tasks_.empty() && active_ == 0; });
+  }
+
+  std::size_t IniThreadPool::size() const noexcept {
+    return workers_.size();
+  }
+
+  IniThreadPool& IniThreadPool::shared() {
+    static IniThreadPool pool;
+    return pool;
+  }
+
+  void IniThreadPool::work() noexcept {
+    std::unique_lock lock{mutex_};
+
+    for (;;) {
+      ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty())
+	return;
+
+      auto task = std::move(tasks_.front());
+      tasks_.pop_front();
+      active_++;
+      lock.unlock();
+
+      try {
+	task();
+      } catch (...) {
+	// Nobody is waiting on a posted task, keep the worker alive.
+      }
+
+      lock.lock();
+      if (--active_ == 0 && tasks_.empty())
+	idle_.notify_all();
+    }
+  }
+};
@@ -0,0 +1,225 @@
+#include <libini/libini.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool condition, std::string_view what) {
+    if (!condition) {
+      std::cerr << "FAILED: " << what << '\n';
+      failures++;
+    }
+  }
+
+  bool same_value(const libini::IniVariant& a, const libini::IniVariant& b) {
+    if (a.index() != b.index())
+      return false;
+    if (auto value = std::get_if<libini::IniInteger>(&a))
+      return value->token_value == std::get<libini::IniInteger>(b).token_value;
+    if (auto value = std::get_if<libini::IniFloat>(&a))
+      return value->token_value == std::get<libini::IniFloat>(b).token_value;
+    return std::get<libini::IniString>(a).token_value == std::get<libini::IniString>(b).token_value;
+  }
+
+  // Same sections, members and values in the same order.
+  bool same_tree(const libini::IniParserResult& a, const libini::IniParserResult& b) {
+    if (a.size() != b.size())
+      return false;
+
+    auto node = b.begin();
+    for (const auto& section : a) {
+      if (section.get_name() != node->get_name() || section.size() != node->size())
+	return false;
+
+      auto leaf = node->begin();
+      for (const auto& member : section) {
+	if (member.get_name() != leaf->get_name() || !same_value(member.get_variant(), leaf->get_variant()))
+	  return false;
+	++leaf;
+      }
+      ++node;
+    }
+
+    return true;
+  }
+
+  // Versions of a file that differ in size and in every value, each telling which it is.
+  std::string version_text(int version) {
+    std::string text = "[meta]\nversion = " + std::to_string(version) + "\n";
+    for (int s = 0; s < 200 + version * 10; s++) {
+      text += "[section" + std::to_string(s) + "]\n";
+      text += "number = " + std::to_string(s * 10 + version) + "\n";
+      text += "text = 'value " + std::to_string(version) + " " + std::to_string(s) + "'\n";
+    }
+    return text;
+  }
+
+  // Replaces the file in one step, so a reader sees one version or the other.
+  void replace(const std::filesystem::path& path, std::string_view text) {
+    auto temporary = path;
+    temporary += ".new";
+    {
+      std::ofstream file{temporary, std::ios_base::binary | std::ios_base::trunc};
+      file << text;
+    }
+    std::filesystem::rename(temporary, path);
+  }
+
+  // What ChangingLexer reads, in turn.
+  std::vector<std::string> changing_texts;
+
+  // A source that changes between reads, as a file being rewritten does: every read gives the next version.
+  class ChangingLexer {
+  public:
+    ChangingLexer(const std::string&) noexcept {}
+
+    libini::IniTokens tokenize(std::pmr::polymorphic_allocator<libini::IniVariant> allocator) {
+      return libini::IniLexer{read()}.tokenize(allocator);
+    }
+
+    libini::IniTokens operator ()(std::pmr::polymorphic_allocator<libini::IniVariant> allocator) {
+      return tokenize(allocator);
+    }
+
+    libini::IniTokenStream stream() {
+      auto text = read();
+      return {text.data(), text.data() + text.size()};
+    }
+
+  private:
+    std::size_t reads_ = 0;
+
+    std::string_view read() {
+      return changing_texts[reads_++ % changing_texts.size()];
+    }
+  };
+
+  // The cache key and the stored tree come from the same read of the source.
+  void test_one_read() {
+    libini::IniParseCache cache{std::filesystem::temp_directory_path() / "libini_cache_test" / "one_read"};
+    changing_texts = {version_text(11), version_text(12)};
+    auto expected = libini::IniParser(std::string_view{changing_texts[0]}).parse();
+
+    auto result = libini::IniParser<ChangingLexer>{"changing"}.parse(cache);
+    check(same_tree(result, expected), "parse(cache) builds the tree from the text it read");
+    check(same_tree(libini::IniParser(std::string_view{changing_texts[0]}).parse(cache), expected),
+	  "parse(cache) stores the tree under the key of its text");
+  }
+
+  // The tree parsed from a file changing under the parser is that of the version it read, and so is the entry it stored.
+  template<typename LexerType>
+  void test_file_changing(const std::filesystem::path& directory) {
+    constexpr int versions = 4;
+    std::vector<std::string> texts;
+    std::vector<libini::IniParserResult> expected;
+    for (int version = 0; version < versions; version++) {
+      texts.push_back(version_text(version));
+      expected.push_back(libini::IniParser(std::string_view{texts.back()}).parse());
+    }
+
+    libini::IniParseCache cache{directory / "entries"};
+    auto path = directory / "changing.ini";
+    replace(path, texts[0]);
+
+    std::atomic<bool> stop{false};
+    std::thread writer{[&] {
+      for (int round = 1; !stop.load(); round++)
+	replace(path, texts[static_cast<std::size_t>(round % versions)]);
+    }};
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 2; reader++)
+      readers.emplace_back([&] {
+	for (int round = 0; round < 100; round++) {
+	  libini::IniParserResult result = libini::IniParser<LexerType>{path.string()}.parse(cache);
+	  auto version = result.get_value<libini::IniInteger>("meta.version");
+	  if (version < 0 || version >= versions || !same_tree(result, expected[static_cast<std::size_t>(version)]))
+	    mismatches++;
+	}
+      });
+
+    for (auto& reader : readers)
+      reader.join();
+    stop = true;
+    writer.join();
+
+    check(mismatches == 0, "a file changing under parse(cache) gives one whole version");
+
+    // Every entry must hold the tree of the text it is keyed by.
+    bool stored = true;
+    for (int version = 0; version < versions; version++) {
+      auto& text = texts[static_cast<std::size_t>(version)];
+      auto cached = libini::IniParser(std::string_view{text}).parse(cache);
+      stored = stored && same_tree(cached, expected[static_cast<std::size_t>(version)]);
+    }
+    check(stored, "cached entries match the text they are keyed by");
+  }
+
+  // A corrupt entry is a miss, parsed again and replaced.
+  void test_corrupt_entries(const std::filesystem::path& directory) {
+    libini::IniParseCache cache{directory / "entries"};
+    auto text = version_text(7);
+    auto expected = libini::IniParser(std::string_view{text}).parse();
+    libini::IniParser(std::string_view{text}).parse(cache);
+
+    for (const auto& entry : std::filesystem::directory_iterator{cache.directory()}) {
+      std::ofstream file{entry.path(), std::ios_base::binary | std::ios_base::in | std::ios_base::out};
+      file << "garbage";
+    }
+
+    check(!cache.load(text).has_value(), "a corrupt entry is not loaded");
+    check(same_tree(libini::IniParser(std::string_view{text}).parse(cache), expected), "a corrupt entry is parsed again");
+    check(cache.load(text).has_value(), "a corrupt entry is replaced");
+  }
+
+  // Threads storing the same text at once leave one valid entry.
+  void test_concurrent_stores(const std::filesystem::path& directory) {
+    libini::IniParseCache cache{directory / "concurrent"};
+    auto text = version_text(9);
+    auto expected = libini::IniParser(std::string_view{text}).parse();
+
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < 4; thread++)
+      threads.emplace_back([&] {
+	for (int round = 0; round < 20; round++)
+	  cache.store(text, expected);
+      });
+    for (auto& thread : threads)
+      thread.join();
+
+    std::size_t entries = 0;
+    for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator{cache.directory()})
+      entries++;
+
+    check(entries == 1, "concurrent stores leave a single entry");
+    check(same_tree(libini::IniParser(std::string_view{text}).parse(cache), expected), "the entry is whole");
+  }
+};
+
+int main(void) {
+  auto directory = std::filesystem::temp_directory_path() / "libini_cache_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  test_one_read();
+  test_file_changing<libini::IniLexer>(directory);
+  test_file_changing<libini::MmapLexer>(directory);
+  test_corrupt_entries(directory);
+  test_concurrent_stores(directory);
+
+  std::filesystem::remove_all(directory);
+
+  if (failures == 0)
+    std::cout << "All tests passed.\n";
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+#include <libini/libini.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool condition, std::string_view what) {
+    if (!condition) {
+      std::cerr << "FAILED: " << what << '\n';
+      failures++;
+    }
+  }
+
+  // A token as text, its type first, so sequences of tokens compare as vectors of strings.
+  std::string show(const libini::IniVariant& token) {
+    return std::to_string(token.index()) + ":" + std::visit([](const auto& t) -> std::string {
+      using T = std::decay_t<decltype(t)>;
+      if constexpr (std::same_as<T, libini::IniInteger> || std::same_as<T, libini::IniFloat>)
+	return std::to_string(t.token_value);
+      else if constexpr (requires { t.token_value; })
+	return std::string(t.token_value);
+      else
+	return "";
+    }, token);
+  }
+
+  // The tokens of the whole text, lexed in one go.
+  std::vector<std::string> whole(std::string_view text) {
+    std::vector<std::string> tokens;
+    libini::IniTokenStream stream{text.data(), text.data() + text.size()};
+    while (auto token = stream.next<std::pmr::string>())
+      tokens.push_back(show(*token));
+    return tokens;
+  }
+
+  // The tokens of the text fed in the given pieces, taking tokens out after every piece.
+  std::vector<std::string> fed(std::string_view text, const std::vector<std::size_t>& pieces, bool& done) {
+    std::vector<std::string> tokens;
+    libini::FeedLexer lexer;
+    std::size_t position = 0;
+
+    for (auto size : pieces) {
+      lexer.feed(text.substr(position, size));
+      position += size;
+      while (auto token = lexer.next())
+	tokens.push_back(show(*token));
+    }
+
+    lexer.finish();
+    while (auto token = lexer.next())
+      tokens.push_back(show(*token));
+
+    done = lexer.done();
+    return tokens;
+  }
+
+  // Random pieces of 1 to max bytes that add up to the size.
+  std::vector<std::size_t> random_pieces(std::size_t size, std::size_t max, std::mt19937& random) {
+    std::vector<std::size_t> pieces;
+    std::uniform_int_distribution<std::size_t> length{1, max};
+    for (std::size_t position = 0; position < size;) {
+      pieces.push_back(std::min(length(random), size - position));
+      position += pieces.back();
+    }
+    return pieces;
+  }
+
+  // Every kind of token, with comments, signs, exponents and hexadecimal, and long names to split.
+  std::string sample() {
+    std::string text = "# generated\n";
+    for (int s = 0; s < 40; s++) {
+      text += "[section" + std::to_string(s) + "]\n";
+      text += "integer = " + std::to_string(s * 1000003) + "\n";
+      text += "negative = -" + std::to_string(s) + "\n";
+      text += "float = " + std::to_string(s) + ".25e-3 # trailing comment\n";
+      text += "hex = 0x" + std::to_string(s) + "fF\n";
+      text += "single = 'value " + std::to_string(s) + "'\n";
+      text += "double = \"a longer value that is " + std::string(static_cast<std::size_t>(s), 'x') + " long\"\n";
+      text += "bare = just some words\n";
+      text += "a_much_longer_identifier_than_usual_" + std::to_string(s) + " = true\n";
+    }
+    return text;
+  }
+
+  // Fed in random pieces, the lexer hands out the same tokens as the stream over the whole text.
+  void test_random_pieces() {
+    std::mt19937 random{16};
+    for (std::string text : {sample(), std::string{"[a]\nx = = 1\n[b\ny 'z\n"}}) {
+      auto expected = whole(text);
+
+      bool same = true;
+      bool done = true;
+      for (int round = 0; round < 40; round++) {
+	// Tiny pieces split almost every token, larger ones split some.
+	bool finished = false;
+	same = same && fed(text, random_pieces(text.size(), round < 10 ? 3 : 64, random), finished) == expected;
+	done = done && finished;
+      }
+
+      check(same, "random pieces lex as the whole text");
+      check(done, "every token handed out after finish()");
+    }
+  }
+
+  // A token cut at every position of the text, including inside names, strings and numbers.
+  void test_every_boundary() {
+    std::string_view text = "[section]\nkey = 'quoted value'\nnumber = -12.5e3\nname = bare words\n";
+    auto expected = whole(text);
+
+    bool same = true;
+    for (std::size_t cut = 1; cut < text.size(); cut++) {
+      bool done = false;
+      same = same && fed(text, {cut, text.size() - cut}, done) == expected && done;
+    }
+
+    check(same, "a cut anywhere lexes as the whole text");
+  }
+
+  // A token running up to the end of the input is only complete once finish() says so.
+  void test_partial_token_at_finish() {
+    for (std::string_view text : {"[s]\nk = 12", "[s]\nk = 1.5e", "[s]\nk = 'open", "[s]\nk = bare", "[s]\nkey", "[sec"}) {
+      libini::FeedLexer lexer;
+      lexer.feed(text);
+
+      std::vector<std::string> tokens;
+      while (auto token = lexer.next())
+	tokens.push_back(show(*token));
+
+      auto expected = whole(text);
+      check(tokens.size() < expected.size() && !lexer.done(), "the last token waits for more input");
+
+      lexer.finish();
+      while (auto token = lexer.next())
+	tokens.push_back(show(*token));
+      check(tokens == expected && lexer.done(), "finish() completes the last token");
+    }
+  }
+
+  // A moved lexer goes on where the other one stopped.
+  void test_move() {
+    libini::FeedLexer first;
+    first.feed("[s]\nk = 1");
+    auto second = std::move(first);
+    second.feed("23\n");
+    second.finish();
+
+    std::vector<std::string> tokens;
+    while (auto token = second.next())
+      tokens.push_back(show(*token));
+    check(tokens == whole("[s]\nk = 123\n") && second.done(), "moved lexer keeps its input");
+  }
+};
+
+int main(void) {
+  test_random_pieces();
+  test_every_boundary();
+  test_partial_token_at_finish();
+  test_move();
+
+  if (failures == 0)
+    std::cout << "All tests passed.\n";
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+#include <libini/libini.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool condition, std::string_view what) {
+    if (!condition) {
+      std::cerr << "FAILED: " << what << '\n';
+      failures++;
+    }
+  }
+
+  // A file whose every section holds the same version, so a snapshot mixing two versions shows.
+  std::string version_text(int version, int sections) {
+    std::string text;
+    for (int s = 0; s < sections; s++) {
+      text += "[section" + std::to_string(s) + "]\n";
+      text += "version = " + std::to_string(version) + "\n";
+      text += "padding = 'a value long enough to make the file span several pages'\n";
+    }
+    return text;
+  }
+
+  // Every section of the snapshot holds the same version, which it returns, or -1.
+  std::int64_t whole_version(const libini::IniParserResult& snapshot, std::size_t sections) {
+    if (snapshot.size() != sections)
+      return -1;
+
+    auto version = snapshot.begin()->get_value<libini::IniInteger>("version");
+    for (const auto& section : snapshot)
+      if (section.get_value<libini::IniInteger>("version") != version)
+	return -1;
+    return version;
+  }
+
+  void write(const std::filesystem::path& path, std::string_view text) {
+    std::ofstream file{path, std::ios_base::binary | std::ios_base::trunc};
+    file << text;
+  }
+
+  template<typename Condition>
+  bool wait_for(Condition condition) {
+    for (int i = 0; i < 400 && !condition(); i++)
+      std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    return condition();
+  }
+
+  // Readers only ever see whole versions while the file is replaced by rename, and the last one wins.
+  void test_replaced_by_rename(const std::filesystem::path& directory) {
+    constexpr int sections = 200;
+    auto path = directory / "renamed.ini";
+    write(path, version_text(0, sections));
+    libini::LiveConfig config{path, std::chrono::milliseconds{1}};
+
+    std::atomic<bool> stop{false};
+    std::atomic<long> reads{0};
+    std::atomic<long> torn{0};
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 2; reader++)
+      readers.emplace_back([&] {
+	while (!stop.load()) {
+	  if (whole_version(*config.snapshot(), sections) < 0)
+	    torn++;
+	  reads++;
+	}
+      });
+
+    constexpr int versions = 100;
+    auto temporary = directory / "renamed.ini.new";
+    for (int version = 1; version <= versions; version++) {
+      write(temporary, version_text(version, sections));
+      std::filesystem::rename(temporary, path);
+      if (version % 10 == 0)
+	std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+
+    bool latest = wait_for([&] { return whole_version(*config.snapshot(), sections) == versions; });
+    stop = true;
+    for (auto& reader : readers)
+      reader.join();
+
+    check(latest, "the last version renamed into place is loaded");
+    check(torn == 0 && reads > 0, "snapshots of renamed files are whole");
+    check(config.generation() > 1, "renames are reloaded");
+  }
+
+  // A writer truncating and rewriting the file in place never brings a reload down, and a held
+  // snapshot is not affected by it.
+  void test_truncated_in_place(const std::filesystem::path& directory) {
+    constexpr int sections = 2000;
+    auto path = directory / "truncated.ini";
+    auto text = version_text(1, sections);
+    write(path, text);
+    libini::LiveConfig config{path, std::chrono::milliseconds{1}};
+    auto held = config.snapshot();
+
+    std::atomic<bool> stop{false};
+    std::thread writer{[&] {
+      while (!stop.load()) {
+	int fd = ::open(path.c_str(), O_WRONLY);
+	if (fd < 0)
+	  continue;
+	// The results are irrelevant, the point is the file shrinking and growing under the reader.
+	(void)!::ftruncate(fd, 10);
+	(void)!::pwrite(fd, text.data(), text.size(), 0);
+	::close(fd);
+      }
+    }};
+
+    for (int round = 0; round < 500; round++)
+      config.reload();
+
+    stop = true;
+    writer.join();
+
+    check(whole_version(*held, sections) == 1, "a held snapshot survives reloads");
+    check(config.reload() && whole_version(*config.snapshot(), sections) == 1, "the file reloads once left alone");
+  }
+
+  // A file that goes missing keeps the last snapshot and reports why.
+  void test_missing_file(const std::filesystem::path& directory) {
+    auto path = directory / "missing.ini";
+    write(path, version_text(3, 4));
+    libini::LiveConfig config{path, std::chrono::milliseconds{1}};
+    std::filesystem::remove(path);
+
+    check(!config.reload(), "reloading a missing file fails");
+    check(!config.last_error().empty(), "the failure is reported");
+    check(whole_version(*config.snapshot(), 4) == 3, "the last snapshot is kept");
+
+    bool threw = false;
+    try {
+      libini::LiveConfig none{directory / "none.ini"};
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+    check(threw, "watching a missing file throws");
+  }
+};
+
+int main(void) {
+  auto directory = std::filesystem::temp_directory_path() / "libini_live_config_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  test_replaced_by_rename(directory);
+  test_truncated_in_place(directory);
+  test_missing_file(directory);
+
+  std::filesystem::remove_all(directory);
+
+  if (failures == 0)
+    std::cout << "All tests passed.\n";
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+#include <libini/libini.h>
+#include <malloc.h>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool condition, std::string_view what) {
+    if (!condition) {
+      std::cerr << "FAILED: " << what << '\n';
+      failures++;
+    }
+  }
+
+  // Compares owned and borrowed values alike, the alternatives are in the same order.
+  template<typename A, typename B>
+  bool same_value(const A& a, const B& b) {
+    if (a.index() != b.index())
+      return false;
+    if (auto value = std::get_if<libini::IniInteger>(&a))
+      return value->token_value == std::get<libini::IniInteger>(b).token_value;
+    if (auto value = std::get_if<libini::IniFloat>(&a))
+      return value->token_value == std::get<libini::IniFloat>(b).token_value;
+    return std::string_view{std::get<3>(a).token_value} == std::string_view{std::get<3>(b).token_value};
+  }
+
+  // Same sections, members and values in the same order, and the same answers from the index.
+  bool same_tree(const libini::IniParserResult& a, const libini::IniParserResult& b) {
+    if (a.size() != b.size())
+      return false;
+
+    auto node = b.begin();
+    for (const auto& section : a) {
+      if (section.get_name() != node->get_name() || section.size() != node->size())
+	return false;
+
+      auto leaf = node->begin();
+      for (const auto& member : section) {
+	if (member.get_name() != leaf->get_name() || !same_value(member.get_variant(), leaf->get_variant()))
+	  return false;
+	++leaf;
+      }
+      ++node;
+    }
+
+    for (const auto& section : a)
+      for (const auto& member : section) {
+	auto name = std::string(section.get_name()) + "." + std::string(member.get_name());
+	for (std::string_view lookup : {std::string_view{name}, member.get_name()}) {
+	  auto x = a.find(lookup);
+	  auto y = b.find(lookup);
+	  if (x == nullptr || y == nullptr || !same_value(x->get_variant(), y->get_variant()))
+	    return false;
+	}
+      }
+
+    return true;
+  }
+
+  // Sections whose last value is quoted, the case the lexer used to get wrong for double quotes.
+  std::string quoted_sections(int sections, char quote) {
+    std::string text = "# generated\n";
+    for (int s = 0; s < sections; s++) {
+      text += "[section" + std::to_string(s) + "]\n";
+      text += "number = " + std::to_string(s) + "\n";
+      text += "text = " + std::string(1, quote) + "value " + std::to_string(s) + std::string(1, quote) + "\n";
+    }
+    return text;
+  }
+
+  // A header right after a double-quoted value starts a new section.
+  void test_header_after_double_quote() {
+    std::string_view text = "[a]\nx = \"s\"\n[b]\ny = 2\n";
+    auto result = libini::IniParser(text).parse();
+
+    check(result.size() == 2, "two sections after a double-quoted value");
+    check(result.has_member("a.x") && result.has_member("b.y"), "members of both sections");
+    check(!result.has_member("a.[b]"), "header not read as a member");
+    check(result.get_string("a.x") == "s", "string value read as a view");
+  }
+
+  // Numbers beyond the range of their type are rounded, never silently zeroed.
+  void test_number_range() {
+    std::string_view text = "[n]\nhuge = 1e400\nsmall = -1e400\ntiny = 1e-400\nfraction = 0.0001e309\n"
+      "wide = 18446744073709551616\nmin = -9223372036854775808\n";
+    auto result = libini::IniParser(text).parse();
+    constexpr auto infinity = std::numeric_limits<double>::infinity();
+
+    check(result.get_value<libini::IniFloat>("huge") == infinity, "1e400 is infinite");
+    check(result.get_value<libini::IniFloat>("small") == -infinity, "-1e400 is minus infinity");
+    check(result.get_value<libini::IniFloat>("tiny") == 0.0, "1e-400 is zero");
+    check(result.get_value<libini::IniFloat>("fraction") == 1e305, "0.0001e309 is in range");
+    check(result.get_value<libini::IniFloat>("wide") == 18446744073709551616.0, "integer overflow falls back to a float");
+    check(result.get_value<libini::IniInteger>("min") == std::numeric_limits<std::int64_t>::min(), "smallest integer");
+  }
+
+  // The result does not depend on how many chunks the text is cut into.
+  void test_parallel_matches_parse() {
+    for (char quote : {'"', '\''}) {
+      auto text = quoted_sections(64, quote);
+      auto expected = libini::IniParser(std::string_view{text}).parse();
+      check(expected.size() == 64, "every section parsed");
+
+      for (std::size_t threads = 1; threads <= 8; threads++)
+	check(same_tree(libini::IniParser(std::string_view{text}).parse_parallel(libini::IniThreadPool::shared(), threads), expected),
+	      "parse_parallel() matches parse()");
+    }
+
+    // A key without a value ends with its line, it does not run into the next section.
+    std::string_view text = "[a]\nx = 1\ny\n[b]\nz = 2\n";
+    auto throws = [](auto parse) {
+      try {
+	parse();
+	return false;
+      } catch (const std::runtime_error&) {
+	return true;
+      }
+    };
+
+    check(throws([text] { return libini::IniParser(text).parse(); }), "parse() rejects a key without a value");
+    check(throws([text] { return libini::IniParser(text).parse_parallel(libini::IniThreadPool::shared(), 2); }),
+	  "parse_parallel() rejects a key without a value");
+    check(throws([text] { return libini::IniParser(text).reparse(libini::IniParserResult{libini::IniParserRoots{}}); }),
+	  "reparse() rejects a key without a value");
+  }
+
+  // An image answers every lookup as the result it was compiled from, duplicate and dotted names included.
+  void test_image_matches_parse() {
+    auto text = quoted_sections(64, '\'') + "[section3]\nnumber = 7\n[x]\na.b = 1\n[x.a]\nb = 2\n";
+    auto result = libini::IniParser(std::string_view{text}).parse();
+    auto bytes = libini::compile_image(result);
+    libini::IniImage image{std::span<const std::byte>{bytes}};
+
+    bool same = image.size() == result.size();
+    for (const auto& section : result)
+      for (const auto& member : section) {
+	auto name = std::string(section.get_name()) + "." + std::string(member.get_name());
+	for (std::string_view lookup : {std::string_view{name}, member.get_name()}) {
+	  auto expected = result.find(lookup);
+	  auto found = image.find(lookup);
+	  same = same && found && same_value(expected->get_variant(), found->get_variant());
+	}
+	same = same && !image.find(name + "x") && !image.find(section.get_name(), std::string(member.get_name()) + "x");
+      }
+
+    check(same, "image lookups match the result");
+    check(image.get_value<libini::IniInteger>("number") == 0, "first section wins a bare name");
+    check(image.find("x", "a.b") && image.find("x", "a.b")->get_value<libini::IniInteger>() == 1
+	  && image.find("x.a", "b") && image.find("x.a", "b")->get_value<libini::IniInteger>() == 2,
+	  "dotted names with the same qualified name");
+  }
+
+  // A file that can not be read is a failed outcome, not an empty tree.
+  void test_missing_file() {
+    std::vector<std::filesystem::path> paths{std::filesystem::temp_directory_path() / "libini_missing.ini",
+					     std::filesystem::temp_directory_path()};
+    auto outcomes = libini::parse_all(std::span<const std::filesystem::path>{paths});
+    auto mapped = libini::parse_all<libini::MmapLexer>(std::span<const std::filesystem::path>{paths});
+
+    for (const auto& outcome : outcomes)
+      check(!outcome.ok() && !outcome.error.empty(), "parse_all() reports an unreadable file");
+    for (const auto& outcome : mapped)
+      check(!outcome.ok() && !outcome.error.empty(), "parse_all() reports an unmappable file");
+  }
+
+  // reparse() gives the tree parse() gives for the same text, whatever it was given before.
+  void test_reparse_matches_parse() {
+    for (char quote : {'"', '\''}) {
+      auto text = quoted_sections(64, quote);
+      auto result = libini::IniParser(std::string_view{text}).parse();
+
+      // The first reparse parses everything, the next ones reuse the unchanged sections.
+      for (int round = 0; round < 3; round++) {
+	result = libini::IniParser(std::string_view{text}).reparse(std::move(result));
+	check(same_tree(result, libini::IniParser(std::string_view{text}).parse()), "reparse() matches parse()");
+	check(same_tree(result, libini::IniParser(std::string_view{text}).parse_parallel(libini::IniThreadPool::shared(), 4)),
+	      "reparse() matches parse_parallel()");
+
+	// Edit a section, add one at the end and move one to the front.
+	auto edited = "value " + std::to_string(10 + round);
+	text.replace(text.find(edited), edited.size(), "edited");
+	text += "[added" + std::to_string(round) + "]\nkey = " + std::string(1, quote) + "new" + std::string(1, quote) + "\n";
+	auto moved = text.find("[section" + std::to_string(20 + round) + "]");
+	auto end = text.find("\n[", moved) + 1;
+	text.insert(text.find('['), text.substr(moved, end - moved));
+	text.erase(moved + (end - moved), end - moved);
+      }
+    }
+
+    std::string_view text = "[a]\nx = \"s\"\n[b]\ny = 2\n";
+    auto result = libini::IniParser(text).reparse(libini::IniParser(text).parse());
+    check(same_tree(result, libini::IniParser(text).parse()), "reparse() splits sections as parse() does");
+  }
+
+  // Heap memory in use, as malloc sees it.
+  std::size_t heap_in_use() {
+    auto info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+  }
+
+  // What a long run of reparses leaves behind stays within a small multiple of one tree.
+  void test_reparse_memory_bounded() {
+    auto text = quoted_sections(400, '\'');
+    auto base = heap_in_use();
+    auto result = libini::IniParser(std::string_view{text}).parse();
+    auto tree = heap_in_use() - base;
+
+    std::size_t peak = 0;
+    for (int round = 0; round < 400; round++) {
+      std::string_view from = round % 2 ? "value 7'" : "value 5'";
+      text.replace(text.find(from), from.size(), round % 2 ? "value 5'" : "value 7'");
+      result = libini::IniParser(std::string_view{text}).reparse(std::move(result));
+      peak = std::max(peak, heap_in_use() - base);
+    }
+
+    check(same_tree(result, libini::IniParser(std::string_view{text}).parse()), "reparse() matches parse() after many edits");
+    check(peak < 4 * tree, "reparse() memory stays bounded");
+  }
+};
+
+int main(void) {
+  test_header_after_double_quote();
+  test_number_range();
+  test_parallel_matches_parse();
+  test_image_matches_parse();
+  test_missing_file();
+  test_reparse_matches_parse();
+  test_reparse_memory_bounded();
+
+  if (failures == 0)
+    std::cout << "All tests passed.\n";
+
+  return failures == 0 ? 0 : 1;
+}